@@ -0,0 +1,174 @@
+/*
+  Compare two benchsuite result files, OLD and NEW, matrix by matrix and
+  entry point by entry point.
+
+  A pair is a slowdown when a one-sided Mann-Whitney U test on the runs
+  says NEW is slower than OLD at level alpha (-a, default 0.01), and its
+  median is also more than -t percent (default 5) above the old one, so
+  tiny but consistent shifts do not fail a build. Improvements are found
+  the same way the other way round. Memory has a single sample per pair,
+  the peak RSS, and grows when it rises by more than -m percent (default
+  10). An entry point that ran before but fails now is a regression too,
+  and so is a pair that is missing from NEW altogether, since a run that
+  crashed or was cut short must not pass as clean.
+
+  One line is printed per pair. The exit status is 0 with no
+  regressions, 1 with any, and 2 if the files cannot be read.
+
+  usage: benchcmp [-a alpha] [-t percent] [-m percent] [-q] OLD NEW
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "benchjson.h++"
+
+using namespace std;
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [-a alpha] [-t percent] [-m percent] [-q] OLD NEW\n", prog);
+  exit(2);
+}
+
+// One-sided p-value for "ys tend to be larger than xs", by the normal
+// approximation to U with a tie correction and continuity correction.
+// Fine from about eight runs a side, which benchsuite exceeds by default.
+static double mannWhitneyGreater(const vector<double>& xs, const vector<double>& ys) {
+  size_t n1 = xs.size(), n2 = ys.size(), n = n1 + n2;
+  if (n1 == 0 || n2 == 0) {
+    return 1;
+  }
+  vector<pair<double, int>> all;
+  for (double x : xs) {
+    all.emplace_back(x, 0);
+  }
+  for (double y : ys) {
+    all.emplace_back(y, 1);
+  }
+  sort(all.begin(), all.end());
+
+  // Ranks from 1, ties get the average of the ranks they span
+  double rankSumY = 0, ties = 0;
+  for (size_t i = 0; i < n;) {
+    size_t j = i;
+    while (j < n && all[j].first == all[i].first) {
+      j++;
+    }
+    double rank = (i + 1 + j) / 2.0;
+    for (size_t k = i; k < j; k++) {
+      if (all[k].second == 1) {
+        rankSumY += rank;
+      }
+    }
+    double t = j - i;
+    ties += t * t * t - t;
+    i = j;
+  }
+  double u = rankSumY - n2 * (n2 + 1) / 2.0;
+  double mean = n1 * n2 / 2.0;
+  double var = n1 * n2 / 12.0 * ((n + 1) - ties / ((double) n * (n - 1)));
+  if (var <= 0) {
+    return 1;   // every run identical
+  }
+  double z = (u - mean - 0.5) / sqrt(var);
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+int main(int argc, char** argv) {
+  double alpha = 0.01;
+  double timeThreshold = 5;
+  double memThreshold = 10;
+  bool quiet = false;
+
+  int ch;
+  while ((ch = getopt(argc, argv, "a:t:m:q")) != -1) {
+    switch (ch) {
+    case 'a': alpha = atof(optarg); break;
+    case 't': timeThreshold = atof(optarg); break;
+    case 'm': memThreshold = atof(optarg); break;
+    case 'q': quiet = true; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc - 2 || alpha <= 0 || alpha >= 1) {
+    usage(argv[0]);
+  }
+
+  vector<benchResult> olds, news;
+  try {
+    olds = readBenchFile(argv[optind]);
+    news = readBenchFile(argv[optind + 1]);
+  } catch (const exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 2;
+  }
+  map<string, const benchResult*> byKey;
+  for (const benchResult& r : olds) {
+    byKey[r.key()] = &r;
+  }
+
+  int regressions = 0, improvements = 0, compared = 0;
+  for (const benchResult& now : news) {
+    auto it = byKey.find(now.key());
+    if (it == byKey.end()) {
+      if (!quiet) {
+        printf("%-10s %-16s new\n", now.matrix.c_str(), now.entry.c_str());
+      }
+      continue;
+    }
+    const benchResult& before = *it->second;
+    byKey.erase(it);
+
+    if (!now.error.empty() || !before.error.empty()) {
+      bool broke = before.error.empty();
+      regressions += broke;
+      if (broke || !quiet) {
+        printf("%-10s %-16s %s: %s\n", now.matrix.c_str(), now.entry.c_str(),
+               broke ? "REGRESSION, now fails" : now.error.empty() ? "fixed, failed with" : "failing",
+               (now.error.empty() ? before.error : now.error).c_str());
+      }
+      continue;
+    }
+
+    compared++;
+    double change = before.median > 0 ? 100 * (now.median / before.median - 1) : 0;
+    double pSlower = mannWhitneyGreater(before.runs, now.runs);
+    double pFaster = mannWhitneyGreater(now.runs, before.runs);
+    bool slower = pSlower < alpha && change > timeThreshold;
+    bool faster = pFaster < alpha && change < -timeThreshold;
+
+    double memChange = 0;
+    bool memGrew = false;
+    if (before.maxRssKiB > 0 && now.maxRssKiB >= 0) {
+      memChange = 100 * ((double) now.maxRssKiB / before.maxRssKiB - 1);
+      memGrew = memChange > memThreshold;
+    }
+
+    regressions += slower || memGrew;
+    improvements += faster;
+    if (slower || memGrew || faster || !quiet) {
+      string verdict = slower ? "SLOWER" : faster ? "faster" : "same";
+      if (memGrew) {
+        verdict += ", MEMORY";
+      }
+      printf("%-10s %-16s %10.0f -> %10.0f us %+7.1f%% (p %.4f)  rss %+6.1f%%  %s\n",
+             now.matrix.c_str(), now.entry.c_str(), before.median, now.median, change,
+             change >= 0 ? pSlower : pFaster, memChange, verdict.c_str());
+    }
+  }
+  for (const auto& kv : byKey) {
+    regressions++;
+    printf("%-10s %-16s REGRESSION, missing from the new results\n",
+           kv.second->matrix.c_str(), kv.second->entry.c_str());
+  }
+  fprintf(stderr, "%d compared, %d regressions, %d improvements\n", compared, regressions, improvements);
+  return regressions == 0 ? 0 : 1;
+}
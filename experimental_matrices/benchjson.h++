@@ -0,0 +1,60 @@
+/*
+  Reading and writing the JSON of benchsuite and scaling.
+
+  jsonValue is a small DOM, enough for the flat files the tools here
+  write: objects keep their members in order, numbers are doubles.
+  readBenchFile turns a benchsuite file into one benchResult per matrix
+  and entry point.
+*/
+
+#ifndef BENCHJSON_HXX
+#define BENCHJSON_HXX
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class jsonValue {
+public:
+  enum class kind { null, boolean, number, string, array, object };
+
+  kind type = kind::null;
+  bool b = false;
+  double num = 0;
+  std::string str;
+  std::vector<jsonValue> items;
+  std::vector<std::pair<std::string, jsonValue>> members;
+
+  // The member called key, or nullptr if this is no object or lacks it
+  const jsonValue* find(const std::string& key) const;
+
+  double numberOr(const std::string& key, double dflt) const;
+  std::string stringOr(const std::string& key, const std::string& dflt) const;
+};
+
+// Throws std::runtime_error with an offset on malformed input
+jsonValue parseJson(const std::string& text);
+
+// s as a JSON string literal, quotes included
+std::string jsonQuote(const std::string& s);
+
+struct benchResult {
+  std::string matrix;
+  std::string entry;
+  std::string representation;
+  std::string operation;
+  int64_t nnz = 0;
+  std::vector<double> runs;   // microseconds
+  double median = 0;
+  int64_t maxRssKiB = -1;     // -1 if not recorded
+  std::string error;          // empty if the run succeeded
+
+  std::string key() const { return matrix + " " + entry; }
+};
+
+std::vector<benchResult> readBenchFile(const std::string& path);
+
+#include "benchjson.i++"
+
+#endif
@@ -0,0 +1,105 @@
+/*
+  Running the entry points of src/bench.fut on a matrix, shared by
+  benchsuite and scaling.
+
+  benchInputs turns an edge list or Matrix Market file into the three
+  input files the entry points take (see the top of src/bench.fut) in a
+  private temporary directory. The COO, CSR and CSC forms come from the
+  conversion cache of csrcache.h++, so a matrix is parsed and compressed
+  only the first time; after that preparing it is mapping the cached
+  files and copying them out. runBenchEntry runs one entry point of a compiled benchmark
+  program as
+
+    PROGRAM ARGS... -b -e ENTRY -r WARMUP+REPS -t TIMES < input
+
+  and summarises the timed runs after dropping the first WARMUP. The
+  program does one untimed warmup run of its own before those.
+  runWorkEntry runs the companion ENTRY_work once and reads the flops
+  and bytes of one call from its output.
+*/
+
+#ifndef BENCHRUN_HXX
+#define BENCHRUN_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "csrcache.h++"
+
+// How an entry point wants its matrix
+enum class benchInput { coo, csr, csrCsc };
+
+struct benchOperation {
+  const char* repr;
+  const char* name;
+  const char* entry;
+  benchInput input;
+  bool segmented;         // built on segmented_scan/segmented_reduce
+};
+
+const std::vector<benchOperation>& benchOperations();
+
+// Whether op is in the comma separated list only; an empty list has all
+bool benchSelected(const std::string& only, const benchOperation& op);
+
+struct benchSummary {
+  std::vector<double> runs;     // microseconds, warmup dropped
+  double median = 0;
+  double p95 = 0;
+  double mean = 0;
+  double min = 0;
+  int64_t maxRssKiB = 0;        // of the whole process, all runs
+};
+
+benchSummary summariseRuns(std::vector<double> runs);
+
+// Algorithmic work of one call of an entry point, -1 if unknown
+struct benchWork {
+  int64_t flops = -1;
+  int64_t bytes = -1;
+};
+
+class benchInputs {
+public:
+  // An empty cacheDir means the default of conversionCache
+  explicit benchInputs(const std::string& cacheDir = "");
+  ~benchInputs();
+
+  benchInputs(const benchInputs&) = delete;
+  benchInputs& operator=(const benchInputs&) = delete;
+
+  // Write the inputs for a matrix, replacing the last
+  void prepare(const std::string& matrix, unsigned threads = 0);
+
+  const std::string& path(benchInput kind) const { return inputs[static_cast<int>(kind)]; }
+  const std::string& timesPath() const { return times; }
+
+  int32_t dim = 0;
+  int64_t nnz = 0;
+
+  conversionCache cache;
+
+private:
+  std::string dir;
+  std::string inputs[3];
+  std::string times;
+};
+
+// Empty on success, else why the run failed
+std::string runBenchEntry(const std::string& program, const std::vector<std::string>& args,
+                          const benchOperation& op, const benchInputs& in,
+                          int warmup, int reps, benchSummary& res);
+
+// Empty on success, else why the run failed
+std::string runWorkEntry(const std::string& program, const std::vector<std::string>& args,
+                         const benchOperation& op, const benchInputs& in, benchWork& res);
+
+// The N_density (and N_model) files of dir, by size and then name
+std::vector<std::string> defaultMatrices(const std::string& dir);
+
+std::string baseName(const std::string& path);
+
+#include "benchrun.i++"
+
+#endif
@@ -0,0 +1,193 @@
+/*
+  Benchmark suite over the N_density matrices in this directory.
+
+  Every matrix is read once, turned into the inputs described at the top
+  of src/bench.fut, and each entry point of the compiled benchmark
+  program is run on it through benchrun.h++. The program does one
+  untimed warmup run of its own; the first WARMUP timed runs are dropped
+  as well, and the remaining REPS give the median,
+  95th percentile, mean and minimum, and a throughput of nnz per second
+  at the median. The peak resident set of the run is kept as a measure
+  of memory use. Results go to stdout (or -o FILE) as JSON, one record
+  per matrix and operation, with the raw runs kept for later comparison
+  by benchcmp.
+
+  With no MATRIX arguments all N_density files in the current directory
+  are used, smallest first. -e restricts the run to a comma separated
+  list of entry points.
+
+  -R adds a roofline report. The host's memory bandwidth is measured
+  first with a STREAM triad over -M MiB (stream.h++), and every entry
+  point's ENTRY_work companion gives the flops and minimum bytes of one
+  call. At the median time these become achieved GFLOP/s and GB/s, the
+  arithmetic intensity in flops per byte, the GFLOP/s the memory roof
+  allows at that intensity, and the fraction of the measured bandwidth
+  the entry point reaches.
+
+  usage: benchsuite [-w warmup] [-r reps] [-j threads] [-e entries] [-R] [-M MiB]
+                    [-o FILE] PROGRAM [MATRIX...]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "benchjson.h++"
+#include "benchrun.h++"
+#include "stream.h++"
+
+using namespace std;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [-w warmup] [-r reps] [-j threads] [-e entries] [-R] [-M MiB]\n"
+          "          [-o FILE] PROGRAM [MATRIX...]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  int warmup = 2;
+  int reps = 10;
+  unsigned threads = 0;
+  string only = "";
+  string outPath = "";
+  bool roofline = false;
+  size_t streamMiB = 512;
+
+  int ch;
+  while ((ch = getopt(argc, argv, "w:r:j:e:RM:o:")) != -1) {
+    switch (ch) {
+    case 'w': warmup = atoi(optarg); break;
+    case 'r': reps = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    case 'e': only = optarg; break;
+    case 'R': roofline = true; break;
+    case 'M': streamMiB = atoi(optarg); break;
+    case 'o': outPath = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind >= argc || warmup < 0 || reps < 1 || streamMiB < 1) {
+    usage(argv[0]);
+  }
+  string program = argv[optind++];
+  if (program.find('/') == string::npos) {
+    program = "./" + program;
+  }
+  vector<string> matrices(argv + optind, argv + argc);
+  if (matrices.empty()) {
+    matrices = defaultMatrices(".");
+  }
+  if (matrices.empty()) {
+    fprintf(stderr, "no N_density matrices found\n");
+    return 1;
+  }
+
+  double bandwidth = 0;
+  if (roofline) {
+    bandwidth = streamTriad(streamMiB << 20, threads);
+    fprintf(stderr, "STREAM triad over %zu MiB: %.2f GB/s\n", streamMiB, bandwidth);
+  }
+
+  FILE* out = stdout;
+  if (outPath != "" && (out = fopen(outPath.c_str(), "w")) == nullptr) {
+    perror(outPath.c_str());
+    return 1;
+  }
+  struct utsname host;
+  uname(&host);
+  fprintf(out, "{\n  \"program\": %s,\n  \"warmup\": %d,\n  \"repetitions\": %d,\n",
+          jsonQuote(program).c_str(), warmup, reps);
+  fprintf(out, "  \"host\": { \"system\": %s, \"release\": %s, \"machine\": %s, \"cpus\": %u",
+          jsonQuote(host.sysname).c_str(), jsonQuote(host.release).c_str(),
+          jsonQuote(host.machine).c_str(), thread::hardware_concurrency());
+  if (roofline) {
+    fprintf(out, ", \"stream_triad_gbs\": %.3f", bandwidth);
+  }
+  fprintf(out, " },\n");
+  fprintf(out, "  \"results\": [");
+
+  benchInputs inputs;
+
+  int failures = 0;
+  bool first = true;
+  for (const string& path : matrices) {
+    try {
+      inputs.prepare(path, threads);
+    } catch (const exception& e) {
+      fprintf(stderr, "%s: %s\n", path.c_str(), e.what());
+      failures++;
+      continue;
+    }
+    int32_t dim = inputs.dim;
+    int64_t nnz = inputs.nnz;
+
+    for (const benchOperation& op : benchOperations()) {
+      if (!benchSelected(only, op)) {
+        continue;
+      }
+      benchSummary s;
+      string error = runBenchEntry(program, {}, op, inputs, warmup, reps, s);
+      benchWork w;
+      string workError = roofline && error == "" ? runWorkEntry(program, {}, op, inputs, w) : "";
+      // Per microsecond, 1e3 flops or bytes make 1 G per second
+      bool timed = w.flops >= 0 && s.median > 0;
+      double gflops = timed ? w.flops / (s.median * 1e3) : 0;
+      double gbps = timed ? w.bytes / (s.median * 1e3) : 0;
+      double intensity = timed && w.bytes > 0 ? (double) w.flops / w.bytes : 0;
+
+      fprintf(stderr, "%-10s %-8s %-12s ", baseName(path).c_str(), op.repr, op.name);
+      if (error != "") {
+        fprintf(stderr, "failed: %s\n", error.c_str());
+        failures++;
+      } else {
+        fprintf(stderr, "median %10.0f us  p95 %10.0f us", s.median, s.p95);
+        if (workError != "") {
+          fprintf(stderr, "  no work: %s", workError.c_str());
+        } else if (timed) {
+          fprintf(stderr, "  %7.3f GFLOP/s %7.2f GB/s  %5.1f%% of roof", gflops, gbps,
+                  bandwidth > 0 ? 100 * gbps / bandwidth : 0.0);
+        }
+        fprintf(stderr, "\n");
+      }
+
+      fprintf(out, "%s\n    { \"matrix\": %s, \"dim\": %d, \"nnz\": %lld, "
+              "\"representation\": %s, \"operation\": %s, \"entry\": %s",
+              first ? "" : ",", jsonQuote(baseName(path)).c_str(), dim, (long long) nnz,
+              jsonQuote(op.repr).c_str(), jsonQuote(op.name).c_str(), jsonQuote(op.entry).c_str());
+      first = false;
+      if (error != "") {
+        fprintf(out, ", \"error\": %s }", jsonQuote(error).c_str());
+        continue;
+      }
+      fprintf(out, ",\n      \"median_us\": %.1f, \"p95_us\": %.1f, \"mean_us\": %.1f, \"min_us\": %.1f,"
+              " \"nnz_per_sec\": %.1f, \"max_rss_kib\": %lld,\n      \"runs_us\": [",
+              s.median, s.p95, s.mean, s.min, s.median > 0 ? nnz / (s.median * 1e-6) : 0.0,
+              (long long) s.maxRssKiB);
+      for (size_t i = 0; i < s.runs.size(); i++) {
+        fprintf(out, "%s%.0f", i == 0 ? "" : ", ", s.runs[i]);
+      }
+      fprintf(out, "]");
+      if (workError != "") {
+        fprintf(out, ",\n      \"work_error\": %s", jsonQuote(workError).c_str());
+      } else if (timed) {
+        fprintf(out, ",\n      \"flops\": %lld, \"bytes\": %lld, \"gflops\": %.4f, \"gbps\": %.4f,"
+                " \"intensity\": %.4f, \"roof_gflops\": %.4f, \"bandwidth_fraction\": %.4f",
+                (long long) w.flops, (long long) w.bytes, gflops, gbps, intensity,
+                intensity * bandwidth, bandwidth > 0 ? gbps / bandwidth : 0.0);
+      }
+      fprintf(out, " }");
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+/*
+  On-disk cache of converted input matrices.
+
+  A source file (an "i j" edge list or a Matrix Market file) is converted
+  once to the native format of csrfile.h++ and kept under a name made of
+  a hash of its contents, size and modification time (and of the
+  dimension in its name, for edge lists), the requested layout and the
+  converter version:
+
+    <64 bit content hash>-<csr|csc|coo>-v<file version>.<converter version>.csr
+
+  so an edited source, a different layout or a new converter never hits a
+  stale entry. Every hit refreshes the entry's modification time, and
+  after a store the least recently used entries are removed until the
+  cache fits its size cap again. Entries are written under a unique
+  temporary name and renamed, so concurrent runs at worst convert twice.
+*/
+
+#ifndef CSRCACHE_HXX
+#define CSRCACHE_HXX
+
+#include <cstdint>
+#include <string>
+
+#include "csrfile.h++"
+
+// Bump when the conversion itself changes
+const uint32_t csrCacheConverterVersion = 1;
+
+class conversionCache {
+public:
+  // An empty dir means $FUTHARK_SPARSE_CACHE, then ~/.cache/futhark-sparse
+  explicit conversionCache(const std::string& dir = "", int64_t capBytes = defaultCap);
+
+  // Path of the converted matrix, converting the source on a miss
+  std::string get(const std::string& source, csrKind kind, unsigned threads = 0);
+
+  // Remove least recently used entries, keeping keep, until under the cap
+  void evict(const std::string& keep = "");
+
+  const std::string& directory() const { return dir; }
+
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+
+  static const int64_t defaultCap = int64_t(1) << 30;
+
+private:
+  std::string dir;
+  int64_t cap;
+};
+
+// FNV-1a over the bytes of path, then its size and modification time
+uint64_t hashFile(const std::string& path);
+
+// Convert an edge list or Matrix Market file to the native format
+void convertToCsrFile(const std::string& source, const std::string& dest, csrKind kind, unsigned threads = 0);
+
+#include "csrcache.i++"
+
+#endif
@@ -0,0 +1,367 @@
+/*
+  Convert matrices to and from the native format in csrfile.h++.
+
+    pack  EDGES OUT   compress an "i j" edge list, values all one
+    mtx   MTX OUT     convert a Matrix Market coordinate file
+    save  OUT         store N M vals ptr idx, read in Futhark's binary
+                      format on stdin (e.g. from fromListTest in csr_test)
+    load  FILE        print N M vals ptr idx as Futhark input values
+    info  FILE        print the header
+    cache SOURCE      print the path of SOURCE converted through the
+                      cache in csrcache.h++, converting on a miss
+    zip   IN OUT      compress a file with csrzip.h++
+    unzip IN OUT      and back
+
+  load and info accept compressed files as well. A benchmark that only
+  wants to measure kernels can read its input with
+
+    csrfile load $(csrfile cache 2100_0.1) | ./program
+
+  -c stores or expects CSC instead of CSR. pack takes the dimension from
+  the N_density file name unless given with -n, like edges2fut.
+
+  usage: csrfile pack [-c] [-j threads] [-n dim] [-v bool|i32|f32] EDGES OUT
+         csrfile mtx [-j threads] MTX OUT
+         csrfile save [-c] OUT
+         csrfile load [-t] [-j threads] FILE
+         csrfile info FILE
+         csrfile cache [-c | -o] [-d dir] [-m MiB] [-j threads] SOURCE
+         csrfile zip [-b rows] [-j threads] IN OUT
+         csrfile unzip [-j threads] IN OUT
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include "timer.h++"
+#include "edgelist.h++"
+#include "futhark_io.h++"
+#include "csrfile.h++"
+#include "csrcache.h++"
+#include "csrzip.h++"
+#include "mtx.h++"
+
+using namespace std;
+using futhark_io::fbool;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s pack [-c] [-j threads] [-n dim] [-v bool|i32|f32] EDGES OUT\n"
+          "       %s mtx [-j threads] MTX OUT\n"
+          "       %s save [-c] OUT\n"
+          "       %s load [-t] [-j threads] FILE\n"
+          "       %s info FILE\n"
+          "       %s cache [-c | -o] [-d dir] [-m MiB] [-j threads] SOURCE\n"
+          "       %s zip [-b rows] [-j threads] IN OUT\n"
+          "       %s unzip [-j threads] IN OUT\n", prog, prog, prog, prog, prog, prog, prog, prog);
+  exit(1);
+}
+
+template <typename T>
+static void writeVals(FILE* out, bool binary, const void* vals, int64_t n) {
+  futhark_io::writeArray(out, binary, static_cast<const T*>(vals), n);
+}
+
+static void writeMatrix(FILE* out, bool binary, const csrFileHeader& h,
+                        const int32_t* ptr, const int32_t* idx, const void* vals) {
+  futhark_io::writeScalar(out, binary, (int32_t) h.rows);
+  futhark_io::writeScalar(out, binary, (int32_t) h.cols);
+  string type(h.valType, 4);
+  if (type == "bool") {
+    writeVals<fbool>(out, binary, vals, h.nnz);
+  } else if (type == " i32") {
+    writeVals<int32_t>(out, binary, vals, h.nnz);
+  } else if (type == " i64") {
+    writeVals<int64_t>(out, binary, vals, h.nnz);
+  } else if (type == " f32") {
+    writeVals<float>(out, binary, vals, h.nnz);
+  } else if (type == " f64") {
+    writeVals<double>(out, binary, vals, h.nnz);
+  } else {
+    throw runtime_error("no output for values of type '" + type + "'");
+  }
+  futhark_io::writeArray(out, binary, ptr, h.ptrLen());
+  futhark_io::writeArray(out, binary, idx, h.nnz);
+}
+
+// Parse -t, -j and -b for the commands that take them
+static unsigned threadsOption(int argc, char** argv, const char* opts, bool& text, uint32_t& blockRows) {
+  unsigned threads = 0;
+  int ch;
+  while ((ch = getopt(argc, argv, opts)) != -1) {
+    switch (ch) {
+    case 't': text = true; break;
+    case 'j': threads = atoi(optarg); break;
+    case 'b': blockRows = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  return threads;
+}
+
+template <typename T>
+static vector<T> ones(int64_t n) {
+  if constexpr (is_same<T, fbool>::value) {
+    return vector<T>(n, fbool::yes);
+  } else {
+    return vector<T>(n, 1);
+  }
+}
+
+template <typename T>
+static void packAs(const string& out, csrKind kind, int32_t dim, const csrArrays& a) {
+  int64_t nnz = a.idx.size();
+  vector<T> vals = ones<T>(nnz);
+  csrFileHeader h = makeCsrHeader(kind, dim, dim, nnz, futhark_io::typeInfo<T>::bin, sizeof(T));
+  writeCsrFile(out, h, a.ptr.data(), a.idx.data(), vals.data());
+}
+
+static int pack(int argc, char** argv, csrKind kind) {
+  unsigned threads = 0;
+  int32_t dim = -1;
+  string vals = "bool";
+
+  int ch;
+  while ((ch = getopt(argc, argv, "cj:n:v:")) != -1) {
+    switch (ch) {
+    case 'c': kind = csrKind::csc; break;
+    case 'j': threads = atoi(optarg); break;
+    case 'n': dim = atoi(optarg); break;
+    case 'v': vals = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc - 2 || (vals != "bool" && vals != "i32" && vals != "f32")) {
+    usage(argv[0]);
+  }
+  string path = argv[optind];
+  string out = argv[optind + 1];
+
+  timer clock;
+  clock.start();
+  edgeList edges = parseEdgeList(path, threads);
+  if (dim < 0) {
+    dim = dimFromFileName(path);
+  }
+  if (dim < 0) {
+    dim = edges.maxIndex + 1;
+  }
+  csrArrays a = compressEdges(edges, kind, dim, threads);
+  if (vals == "bool") {
+    packAs<fbool>(out, kind, dim, a);
+  } else if (vals == "i32") {
+    packAs<int32_t>(out, kind, dim, a);
+  } else {
+    packAs<float>(out, kind, dim, a);
+  }
+  clock.stop();
+  fprintf(stderr, "%s: %lld edges, %dx%d, packed in %.2f ms\n",
+          out.c_str(), (long long) edges.size(), dim, dim, clock.getElapsedTimeMilliSec());
+  return 0;
+}
+
+static int mtx(int argc, char** argv) {
+  bool text = false;
+  uint32_t blockRows = 0;
+  unsigned threads = threadsOption(argc, argv, "j:", text, blockRows);
+  if (optind != argc - 2) {
+    usage(argv[0]);
+  }
+  timer clock;
+  clock.start();
+  mtxMatrix m = readMatrixMarket(argv[optind], threads);
+  clock.stop();
+  fprintf(stderr, "%s: %lldx%lld, %lld entries, %lld nonzeros, read in %.2f ms\n",
+          argv[optind], (long long) m.header.rows, (long long) m.header.cols,
+          (long long) m.header.entries, (long long) m.nnz(), clock.getElapsedTimeMilliSec());
+  writeCsrFile(argv[optind + 1], m.fileHeader(), m.rowPtr.data(), m.cols.data(), m.vals.data());
+  return 0;
+}
+
+static futhark_io::value readOrFail(const char* what) {
+  futhark_io::value v;
+  if (!futhark_io::readValue(stdin, v)) {
+    throw runtime_error(string("missing ") + what + " on stdin");
+  }
+  return v;
+}
+
+static int save(int argc, char** argv, csrKind kind) {
+  int ch;
+  while ((ch = getopt(argc, argv, "c")) != -1) {
+    switch (ch) {
+    case 'c': kind = csrKind::csc; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+  }
+  int32_t rows = readOrFail("N").scalar<int32_t>();
+  int32_t cols = readOrFail("M").scalar<int32_t>();
+  futhark_io::value vals = readOrFail("vals");
+  futhark_io::value ptr = readOrFail("pointers");
+  futhark_io::value idx = readOrFail("indices");
+  int64_t ptrLen = kind == csrKind::csr ? rows : cols;
+  if (ptr.type != " i32" || idx.type != " i32" || ptr.shape.size() != 1 || idx.shape.size() != 1
+      || vals.shape.size() != 1 || ptr.count() != ptrLen || idx.count() != vals.count()) {
+    throw runtime_error("stdin does not hold a matrix as N M vals ptr idx");
+  }
+  csrFileHeader h = makeCsrHeader(kind, rows, cols, vals.count(), vals.type, vals.elemSize());
+  writeCsrFile(argv[optind], h, reinterpret_cast<const int32_t*>(ptr.data.data()),
+               reinterpret_cast<const int32_t*>(idx.data.data()), vals.data.data());
+  return 0;
+}
+
+static int load(int argc, char** argv) {
+  bool text = false;
+  uint32_t blockRows = 0;
+  unsigned threads = threadsOption(argc, argv, "tj:", text, blockRows);
+  if (optind != argc - 1) {
+    usage(argv[0]);
+  }
+  string path = argv[optind];
+
+  timer clock;
+  clock.start();
+  if (isCsrZip(path)) {
+    mappedCsrZip z(path);
+    csrArrays a = z.decode(threads);
+    clock.stop();
+    fprintf(stderr, "%s: %lld nonzeros, decoded in %.3f ms\n",
+            path.c_str(), (long long) z.header().nnz, clock.getElapsedTimeMilliSec());
+    writeMatrix(stdout, !text, z.plainHeader(), a.ptr.data(), a.idx.data(), z.vals());
+  } else {
+    mappedCsrFile m(path);
+    clock.stop();
+    fprintf(stderr, "%s: %lld nonzeros, mapped in %.3f ms\n",
+            path.c_str(), (long long) m.header().nnz, clock.getElapsedTimeMilliSec());
+    writeMatrix(stdout, !text, m.header(), m.ptr(), m.idx(), m.vals());
+  }
+  return 0;
+}
+
+static int info(int argc, char** argv) {
+  if (argc != 3) {
+    usage(argv[0]);
+  }
+  csrFileHeader h;
+  int64_t size;
+  string blocks;
+  if (isCsrZip(argv[2])) {
+    mappedCsrZip z(argv[2]);
+    h = z.plainHeader();
+    size = z.header().fileSize;
+    blocks = ", compressed in " + to_string(z.header().numBlocks()) + " blocks of "
+             + to_string(z.header().blockRows) + " rows";
+  } else {
+    mappedCsrFile m(argv[2]);
+    h = m.header();
+    size = h.fileSize;
+  }
+  printf("format version %u\n%s %lldx%lld, %lld nonzeros of type %.4s (%u bytes)\n%lld bytes%s\n",
+         h.version, csrKindName(h.kind),
+         (long long) h.rows, (long long) h.cols, (long long) h.nnz,
+         h.valType, h.valSize, (long long) size, blocks.c_str());
+  return 0;
+}
+
+static int cache(int argc, char** argv) {
+  csrKind kind = csrKind::csr;
+  string dir = "";
+  int64_t cap = conversionCache::defaultCap;
+  unsigned threads = 0;
+  int ch;
+  while ((ch = getopt(argc, argv, "cod:m:j:")) != -1) {
+    switch (ch) {
+    case 'c': kind = csrKind::csc; break;
+    case 'o': kind = csrKind::coo; break;
+    case 'd': dir = optarg; break;
+    case 'm': cap = atoll(optarg) << 20; break;
+    case 'j': threads = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+  }
+  timer clock;
+  clock.start();
+  conversionCache c(dir, cap);
+  string path = c.get(argv[optind], kind, threads);
+  clock.stop();
+  fprintf(stderr, "%s: cache %s in %.2f ms", argv[optind], c.hits > 0 ? "hit" : "miss",
+          clock.getElapsedTimeMilliSec());
+  if (c.evictions > 0) {
+    fprintf(stderr, ", evicted %lld", (long long) c.evictions);
+  }
+  fprintf(stderr, "\n");
+  printf("%s\n", path.c_str());
+  return 0;
+}
+
+static int zip(int argc, char** argv) {
+  bool text = false;
+  uint32_t blockRows = csrZipBlockRows;
+  unsigned threads = threadsOption(argc, argv, "b:j:", text, blockRows);
+  if (optind != argc - 2) {
+    usage(argv[0]);
+  }
+  mappedCsrFile m(argv[optind]);
+  timer clock;
+  clock.start();
+  writeCsrZip(argv[optind + 1], m.header(), m.ptr(), m.idx(), m.vals(), blockRows, threads);
+  clock.stop();
+  fprintf(stderr, "%s: compressed in %.2f ms\n", argv[optind + 1], clock.getElapsedTimeMilliSec());
+  return 0;
+}
+
+static int unzip(int argc, char** argv) {
+  bool text = false;
+  uint32_t blockRows = 0;
+  unsigned threads = threadsOption(argc, argv, "j:", text, blockRows);
+  if (optind != argc - 2) {
+    usage(argv[0]);
+  }
+  mappedCsrZip z(argv[optind]);
+  csrArrays a = z.decode(threads);
+  writeCsrFile(argv[optind + 1], z.plainHeader(), a.ptr.data(), a.idx.data(), z.vals());
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+  }
+  string cmd = argv[1];
+  // getopt starts after the command
+  optind = 2;
+  try {
+    if (cmd == "pack") {
+      return pack(argc, argv, csrKind::csr);
+    } else if (cmd == "mtx") {
+      return mtx(argc, argv);
+    } else if (cmd == "save") {
+      return save(argc, argv, csrKind::csr);
+    } else if (cmd == "load") {
+      return load(argc, argv);
+    } else if (cmd == "info") {
+      return info(argc, argv);
+    } else if (cmd == "cache") {
+      return cache(argc, argv);
+    } else if (cmd == "zip") {
+      return zip(argc, argv);
+    } else if (cmd == "unzip") {
+      return unzip(argc, argv);
+    }
+  } catch (const exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  usage(argv[0]);
+}
@@ -0,0 +1,102 @@
+/*
+  Native on-disk format for csr_matrix, csc_matrix and coordinate lists.
+
+  A 64 byte header is followed by three sections, each starting on a 64
+  byte boundary and zero padded up to the next one:
+
+    ptr    i32[ptrLen]   row_ptr (CSR) or col_ptr (CSC), starts only,
+                         or the row of every entry (COO)
+    idx    i32[nnz]      cols (CSR, COO) or rows (CSC)
+    vals   valType[nnz]  values, valSize bytes each
+
+  Everything is little-endian, so on the usual hosts the sections can be
+  used in place straight from a read-only mapping of the file. Readers
+  must reject a magic or major version they do not know.
+*/
+
+#ifndef CSRFILE_HXX
+#define CSRFILE_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "edgelist.h++"
+
+const uint32_t csrFileVersion = 1;
+const int64_t csrFileAlign = 64;
+
+enum class csrKind : uint32_t { csr = 0, csc = 1, coo = 2 };
+
+const char* csrKindName(csrKind kind);
+
+struct csrFileHeader {
+  char magic[8];          // "FUTSPMX" and a NUL
+  uint32_t version;
+  csrKind kind;
+  int64_t rows;
+  int64_t cols;
+  int64_t nnz;
+  char valType[4];        // Futhark binary type name, e.g. " f32"
+  uint32_t valSize;
+  int64_t fileSize;       // catches truncated files
+  int64_t reserved;
+
+  // row_ptr has one entry per row, col_ptr one per column
+  int64_t ptrLen() const {
+    return kind == csrKind::csr ? rows : kind == csrKind::csc ? cols : nnz;
+  }
+  int64_t ptrOffset() const;
+  int64_t idxOffset() const;
+  int64_t valsOffset() const;
+  int64_t endOffset() const;
+};
+
+static_assert(sizeof(csrFileHeader) == csrFileAlign, "the header fills exactly one block");
+
+csrFileHeader makeCsrHeader(csrKind kind, int64_t rows, int64_t cols, int64_t nnz,
+                            const std::string& valType, uint32_t valSize);
+
+// Write a matrix to path. The file is written under a temporary name and
+// renamed into place, so readers never see a half-written one.
+void writeCsrFile(const std::string& path, const csrFileHeader& header,
+                  const int32_t* ptr, const int32_t* idx, const void* vals);
+
+// A read-only mapping of a file written by writeCsrFile. Nothing is
+// parsed or copied; the accessors point into the mapping. Opening checks
+// the header and scans ptr and idx once, so a file that opens has sizes
+// matching its types, pointers in order and every index in range.
+class mappedCsrFile {
+public:
+  explicit mappedCsrFile(const std::string& path);
+  ~mappedCsrFile();
+
+  mappedCsrFile(const mappedCsrFile&) = delete;
+  mappedCsrFile& operator=(const mappedCsrFile&) = delete;
+
+  const csrFileHeader& header() const { return *hdr; }
+  const int32_t* ptr() const;
+  const int32_t* idx() const;
+  const void* vals() const;
+
+  // The values as T, if that is what the file holds
+  template <typename T> const T* valsAs() const;
+
+private:
+  const char* base;
+  int64_t size;
+  const csrFileHeader* hdr;
+};
+
+// Compressed arrays built from an edge list, with the indices of each row
+// (column for CSC) sorted and duplicates kept
+struct csrArrays {
+  std::vector<int32_t> ptr;
+  std::vector<int32_t> idx;
+};
+
+csrArrays compressEdges(const edgeList& edges, csrKind kind, int32_t dim, unsigned threads = 0);
+
+#include "csrfile.i++"
+
+#endif
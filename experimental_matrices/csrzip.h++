@@ -0,0 +1,95 @@
+/*
+  Compressed container for csr_matrix and csc_matrix.
+
+  Within a sorted row the column indices grow slowly, so each row is
+  stored as its length followed by the gaps between its indices (the
+  first one taken from zero), all as unsigned LEB128 varints. Rows are
+  grouped into blocks of blockRows rows and an index records where each
+  block starts, both in the file and in the idx array, so the blocks can
+  be decoded in parallel straight into the destination arrays:
+
+    header  64 bytes, like csrfile.h++ but with its own magic
+    index   numBlocks + 1 entries of { i64 byte offset, i64 first nonzero }
+    blocks  the varint streams, back to back
+    vals    valType[nnz], uncompressed, on a 64 byte boundary
+
+  Values are left as they are: they are either all ones or floats, where
+  a gap encoding buys nothing.
+*/
+
+#ifndef CSRZIP_HXX
+#define CSRZIP_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "csrfile.h++"
+
+const uint32_t csrZipVersion = 1;
+const uint32_t csrZipBlockRows = 1024;
+
+struct csrZipHeader {
+  char magic[8];          // "FUTSPMZ" and a NUL
+  uint32_t version;
+  csrKind kind;
+  int64_t rows;
+  int64_t cols;
+  int64_t nnz;
+  char valType[4];
+  uint32_t valSize;
+  uint32_t blockRows;
+  uint32_t reserved;
+  int64_t fileSize;
+
+  int64_t ptrLen() const { return kind == csrKind::csr ? rows : cols; }
+  int64_t numBlocks() const { return (ptrLen() + blockRows - 1) / blockRows; }
+};
+
+static_assert(sizeof(csrZipHeader) == csrFileAlign, "the header fills exactly one block");
+
+struct csrZipBlock {
+  int64_t offset;         // from the start of the file
+  int64_t firstNnz;
+};
+
+// Compress a matrix whose rows (columns for CSC) have sorted indices.
+// Throws std::invalid_argument if they are not sorted.
+void writeCsrZip(const std::string& path, const csrFileHeader& header,
+                 const int32_t* ptr, const int32_t* idx, const void* vals,
+                 uint32_t blockRows = csrZipBlockRows, unsigned threads = 0);
+
+// A read-only mapping of a compressed file; the values are used in place
+// and the indices are decoded on request
+class mappedCsrZip {
+public:
+  explicit mappedCsrZip(const std::string& path);
+  ~mappedCsrZip();
+
+  mappedCsrZip(const mappedCsrZip&) = delete;
+  mappedCsrZip& operator=(const mappedCsrZip&) = delete;
+
+  const csrZipHeader& header() const { return *hdr; }
+  const void* vals() const;
+  template <typename T> const T* valsAs() const;
+
+  // The same header as the uncompressed file would have
+  csrFileHeader plainHeader() const;
+
+  // Decode into ptr[ptrLen] and idx[nnz], one block per task
+  void decode(int32_t* ptr, int32_t* idx, unsigned threads = 0) const;
+  csrArrays decode(unsigned threads = 0) const;
+
+private:
+  const char* base;
+  int64_t size;
+  const csrZipHeader* hdr;
+  const csrZipBlock* index;
+};
+
+// Whether path starts with the magic of a compressed file
+bool isCsrZip(const std::string& path);
+
+#include "csrzip.i++"
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  Parallel parser for the "i j" edge list files in this directory.
+
+  The file is mapped into memory and split into newline-aligned chunks,
+  one per thread. Each thread parses its chunk with a plain digit loop
+  (no locale, no iostreams), and the per-chunk results are concatenated
+  in file order, so the output is identical for any thread count.
+
+  A leading line holding a single number (the edge count written by
+  generate_sparse_matrix.py) is recognised and checked, not treated as
+  an edge. A count that does not match the edges, and negative indices,
+  are errors.
+*/
+
+#ifndef EDGELIST_HXX
+#define EDGELIST_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class edgeList {
+public:
+  std::vector<int32_t> rows;
+  std::vector<int32_t> cols;
+  int64_t declaredCount = -1;   // from the header line, -1 if there was none
+  int32_t maxIndex = -1;
+
+  int64_t size() const { return (int64_t) rows.size(); }
+};
+
+// Parse path using the given number of threads (0 means all cores).
+// Throws std::runtime_error if the file cannot be read or is malformed.
+edgeList parseEdgeList(const std::string& path, unsigned threads = 0);
+
+// Parse an edge list already in memory
+edgeList parseEdgeList(const char* begin, const char* end, unsigned threads = 0);
+
+// The N of a file named N_density, or -1 if the name has another shape
+int32_t dimFromFileName(const std::string& path);
+
+#include "edgelist.i++"
+
+#endif
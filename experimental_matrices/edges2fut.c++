@@ -0,0 +1,91 @@
+/*
+  Convert an "i j" edge list into Futhark input values:
+
+    N M rows cols [vals]
+
+  N = M is taken from the N_density file name unless given with -n, and
+  falls back to the largest index + 1. Output is Futhark's binary format
+  unless -t is given.
+
+  usage: edges2fut [-t] [-j threads] [-n dim] [-v bool|i32|f32] FILE
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include "timer.h++"
+#include "edgelist.h++"
+#include "futhark_io.h++"
+
+using namespace std;
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [-t] [-j threads] [-n dim] [-v bool|i32|f32] FILE\n", prog);
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  bool binary = true;
+  unsigned threads = 0;
+  int32_t dim = -1;
+  string vals = "";
+
+  int ch;
+  while ((ch = getopt(argc, argv, "tj:n:v:")) != -1) {
+    switch (ch) {
+    case 't': binary = false; break;
+    case 'j': threads = atoi(optarg); break;
+    case 'n': dim = atoi(optarg); break;
+    case 'v': vals = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1 || (vals != "" && vals != "bool" && vals != "i32" && vals != "f32")) {
+    usage(argv[0]);
+  }
+  string path = argv[optind];
+
+  timer clock;
+  clock.start();
+  edgeList edges;
+  try {
+    edges = parseEdgeList(path, threads);
+  } catch (const runtime_error& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  clock.stop();
+
+  if (dim < 0) {
+    dim = dimFromFileName(path);
+  }
+  if (dim < 0) {
+    dim = edges.maxIndex + 1;
+  }
+  if (edges.maxIndex >= dim) {
+    fprintf(stderr, "%s: index %d is out of range for dimension %d\n", path.c_str(), edges.maxIndex, dim);
+    return 1;
+  }
+
+  double ms = clock.getElapsedTimeMilliSec();
+  fprintf(stderr, "%s: %lld edges, %dx%d, parsed in %.2f ms\n",
+          path.c_str(), (long long) edges.size(), dim, dim, ms);
+
+  futhark_io::writeScalar(stdout, binary, dim);
+  futhark_io::writeScalar(stdout, binary, dim);
+  futhark_io::writeArray(stdout, binary, edges.rows);
+  futhark_io::writeArray(stdout, binary, edges.cols);
+  if (vals == "bool") {
+    futhark_io::writeArray(stdout, binary, vector<futhark_io::fbool>(edges.size(), futhark_io::fbool::yes));
+  } else if (vals == "i32") {
+    futhark_io::writeArray(stdout, binary, vector<int32_t>(edges.size(), 1));
+  } else if (vals == "f32") {
+    futhark_io::writeArray(stdout, binary, vector<float>(edges.size(), 1.0f));
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+  Writing values in the input formats understood by programs compiled
+  with Futhark, so tools can feed them directly on stdin.
+
+  Binary values are 'b', the format version, the rank, a four character
+  type name and the shape as little-endian i64s, followed by the
+  elements in little-endian row-major order.
+*/
+
+#ifndef FUTHARK_IO_HXX
+#define FUTHARK_IO_HXX
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace futhark_io {
+
+  // Futhark's bool is one byte; std::vector<bool> is not
+  enum class fbool : uint8_t { no = 0, yes = 1 };
+
+  // Type names in the binary and the text format
+  template <typename T> struct typeInfo;
+  template <> struct typeInfo<int32_t> { static constexpr const char* bin = " i32"; static constexpr const char* name = "i32"; };
+  template <> struct typeInfo<int64_t> { static constexpr const char* bin = " i64"; static constexpr const char* name = "i64"; };
+  template <> struct typeInfo<float>   { static constexpr const char* bin = " f32"; static constexpr const char* name = "f32"; };
+  template <> struct typeInfo<double>  { static constexpr const char* bin = " f64"; static constexpr const char* name = "f64"; };
+  template <> struct typeInfo<fbool>   { static constexpr const char* bin = "bool"; static constexpr const char* name = "bool"; };
+
+  bool isBigEndian();
+
+  // Write n elements little-endian, whatever the host byte order
+  template <typename T>
+  void writeLittleEndian(FILE* out, const T* data, int64_t n);
+
+  template <typename T>
+  void writeArray(FILE* out, bool binary, const T* data, int64_t n);
+
+  template <typename T>
+  void writeArray(FILE* out, bool binary, const std::vector<T>& xs);
+
+  template <typename T>
+  void writeScalar(FILE* out, bool binary, T x);
+
+  // A binary value of any type, as read back from a Futhark program
+  struct value {
+    std::string type;               // four character binary type name
+    std::vector<int64_t> shape;     // empty for scalars
+    std::vector<char> data;         // elements in host byte order
+
+    int64_t elemSize() const;
+    int64_t count() const;
+    template <typename T> T scalar() const;
+  };
+
+  // Read the next binary value, skipping leading whitespace. Returns
+  // false at end of input and throws std::runtime_error on bad input.
+  bool readValue(FILE* in, value& v);
+}
+
+#include "futhark_io.i++"
+
+#endif
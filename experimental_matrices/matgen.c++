@@ -0,0 +1,161 @@
+/*
+  Generate a synthetic N x N matrix with matgen.h++ and write it as
+
+    text      the "i j" edge list of generate_sparse_matrix.py, with the
+              entry count on the first line
+    fut       Futhark input values N M rows cols vals, as edges2fut
+    csr, csc, coo   the native format of csrfile.h++
+
+  Values are all true. OUT defaults to N_MODEL (plus .fut or .csr), so
+  the other tools here find the dimension in the name and benchsuite
+  picks the text files up with the N_density ones. The same seed gives
+  the same file for any thread count.
+
+  usage: matgen [-s seed] [-j threads] [-m entries] [-a a,b,c] [-e exponent]
+                [-w bandwidth] [-k block] [-d density] [-f format] MODEL N [OUT]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "timer.h++"
+#include "edgelist.h++"
+#include "futhark_io.h++"
+#include "csrfile.h++"
+#include "matgen.h++"
+
+using namespace std;
+using futhark_io::fbool;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [-s seed] [-j threads] [-m entries] [-a a,b,c] [-e exponent]\n"
+          "          [-w bandwidth] [-k block] [-d density] [-f text|fut|csr|csc|coo] MODEL N [OUT]\n"
+          "MODEL is rmat, chunglu, banded or blockdiag\n", prog);
+  exit(1);
+}
+
+// Format the lines in parallel, one buffer per thread, written in order
+static void writeText(FILE* out, const edgeList& edges, unsigned threads) {
+  int64_t n = edges.size();
+  if (threads == 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  threads = (unsigned) max<int64_t>(1, min<int64_t>(threads, n));
+  vector<string> bufs(threads);
+  vector<thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&bufs, &edges, n, t, threads]() {
+      char line[32];
+      for (int64_t k = n * t / threads; k < n * (t + 1) / threads; k++) {
+        int len = snprintf(line, sizeof(line), "%d %d\n", edges.rows[k], edges.cols[k]);
+        bufs[t].append(line, len);
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  fprintf(out, "%lld\n", (long long) n);
+  for (const string& b : bufs) {
+    fwrite(b.data(), 1, b.size(), out);
+  }
+}
+
+int main(int argc, char** argv) {
+  genParams p;
+  unsigned threads = 0;
+  string format = "text";
+
+  int ch;
+  while ((ch = getopt(argc, argv, "s:j:m:a:e:w:k:d:f:")) != -1) {
+    switch (ch) {
+    case 's': p.seed = strtoull(optarg, nullptr, 0); break;
+    case 'j': threads = atoi(optarg); break;
+    case 'm': p.entries = atoll(optarg); break;
+    case 'a':
+      if (sscanf(optarg, "%lf,%lf,%lf", &p.a, &p.b, &p.c) != 3) {
+        usage(argv[0]);
+      }
+      break;
+    case 'e': p.exponent = atof(optarg); break;
+    case 'w': p.bandwidth = atoi(optarg); break;
+    case 'k': p.blockSize = atoi(optarg); break;
+    case 'd': p.density = atof(optarg); break;
+    case 'f': format = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind + 2 != argc && optind + 3 != argc) {
+    usage(argv[0]);
+  }
+  if (!parseGenModel(argv[optind], p.model)) {
+    usage(argv[0]);
+  }
+  p.dim = atoi(argv[optind + 1]);
+  if (format != "text" && format != "fut" && format != "csr" && format != "csc" && format != "coo") {
+    usage(argv[0]);
+  }
+  string out = optind + 3 == argc ? argv[optind + 2]
+             : to_string(p.dim) + "_" + genModelName(p.model)
+               + (format == "text" ? "" : format == "fut" ? ".fut" : ".csr");
+
+  try {
+    timer clock;
+    clock.start();
+    edgeList edges = generateMatrix(p, threads);
+    clock.stop();
+    double genMs = clock.getElapsedTimeMilliSec();
+
+    clock.start();
+    if (format == "text" || format == "fut") {
+      FILE* f = fopen(out.c_str(), "wb");
+      if (f == nullptr) {
+        throw runtime_error(out + ": " + strerror(errno));
+      }
+      if (format == "text") {
+        writeText(f, edges, threads);
+      } else {
+        futhark_io::writeScalar(f, true, p.dim);
+        futhark_io::writeScalar(f, true, p.dim);
+        futhark_io::writeArray(f, true, edges.rows);
+        futhark_io::writeArray(f, true, edges.cols);
+        futhark_io::writeArray(f, true, vector<fbool>(edges.size(), fbool::yes));
+      }
+      if (fclose(f) != 0) {
+        throw runtime_error(out + ": write failed");
+      }
+    } else {
+      csrKind kind = format == "csc" ? csrKind::csc : csrKind::csr;
+      csrArrays a = compressEdges(edges, kind, p.dim, threads);
+      if (format == "coo") {
+        // The row of every entry, in the sorted order of a.idx
+        vector<int32_t> rows(a.idx.size());
+        for (int32_t i = 0; i < p.dim; i++) {
+          int64_t end = i + 1 < p.dim ? a.ptr[i + 1] : (int64_t) rows.size();
+          fill(rows.begin() + a.ptr[i], rows.begin() + end, i);
+        }
+        a.ptr.swap(rows);
+        kind = csrKind::coo;
+      }
+      vector<fbool> vals(a.idx.size(), fbool::yes);
+      writeCsrFile(out, makeCsrHeader(kind, p.dim, p.dim, a.idx.size(), "bool", 1),
+                   a.ptr.data(), a.idx.data(), vals.data());
+    }
+    clock.stop();
+    fprintf(stderr, "%s: %s, %dx%d, %lld entries, generated in %.2f ms, written in %.2f ms\n",
+            out.c_str(), genModelName(p.model), p.dim, p.dim, (long long) edges.size(),
+            genMs, clock.getElapsedTimeMilliSec());
+  } catch (const exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+/*
+  Synthetic square matrices with the structure the uniform N_density
+  files lack:
+
+    rmat      R-MAT / Kronecker: each entry picks a quadrant with
+              probabilities a, b, c, d at every level, which gives the
+              skewed degrees of real graphs (Graph500 defaults)
+    chunglu   Chung-Lu: both ends are drawn with probability
+              proportional to a power-law weight (i+1)^(-1/(exponent-1))
+    banded    every position within bandwidth of the diagonal, kept
+              with probability density
+    blockdiag square blocks along the diagonal, filled the same way
+
+  Generation is counter based: entry k of rmat and chunglu, and row i of
+  banded and blockdiag, draw from their own stream derived from the seed,
+  so the threads only split the work and the output is the same for any
+  thread count. Duplicates are kept, as in generate_sparse_matrix.py.
+*/
+
+#ifndef MATGEN_HXX
+#define MATGEN_HXX
+
+#include <cstdint>
+#include <string>
+
+#include "edgelist.h++"
+
+enum class genModel { rmat, chungLu, banded, blockDiagonal };
+
+struct genParams {
+  genModel model = genModel::rmat;
+  int32_t dim = 0;
+  int64_t entries = -1;       // rmat and chunglu; -1 means 16 per row
+  uint64_t seed = 4242;
+  double a = 0.57, b = 0.19, c = 0.19;
+  double exponent = 2.1;
+  int32_t bandwidth = 8;      // banded: half width, the diagonal excluded
+  int32_t blockSize = 64;     // blockdiag
+  double density = 0.5;       // banded and blockdiag fill
+};
+
+// Parse "rmat", "chunglu", "banded" or "blockdiag"; false if none of them
+bool parseGenModel(const std::string& name, genModel& model);
+
+const char* genModelName(genModel model);
+
+// Entries in generation order. Throws std::invalid_argument on bad
+// parameters.
+edgeList generateMatrix(const genParams& p, unsigned threads = 0);
+
+#include "matgen.i++"
+
+#endif
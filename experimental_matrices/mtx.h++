@@ -0,0 +1,58 @@
+/*
+  Parallel reader for Matrix Market coordinate files.
+
+  Supports the real, integer and pattern fields with the general and
+  symmetric qualifiers. The entry lines are split into newline-aligned
+  chunks as in edgelist.h++, and each thread converts its entries to
+  0-based indices and mirrors the off-diagonal ones of symmetric files
+  as it parses. The entries are then bucketed by row in parallel, keeping
+  file order, and every row is sorted by column, so the CSR arrays are
+  the same for any thread count. Explicit zeros and duplicates are kept.
+
+  Values become f32 (real), i32 (integer) or bool (pattern), the element
+  types the Futhark side has monoids for.
+*/
+
+#ifndef MTX_HXX
+#define MTX_HXX
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "csrfile.h++"
+
+enum class mtxField { real, integer, pattern };
+enum class mtxSymmetry { general, symmetric };
+
+struct mtxHeader {
+  mtxField field;
+  mtxSymmetry symmetry;
+  int64_t rows;
+  int64_t cols;
+  int64_t entries;        // as declared, before symmetric expansion
+};
+
+class mtxMatrix {
+public:
+  mtxHeader header;
+  std::vector<int32_t> rowPtr;
+  std::vector<int32_t> cols;
+  std::string valType;    // Futhark binary type name
+  uint32_t valSize;
+  std::vector<char> vals;
+
+  int64_t nnz() const { return (int64_t) cols.size(); }
+  csrFileHeader fileHeader() const;
+};
+
+// Read path using the given number of threads (0 means all cores).
+// Throws std::runtime_error on unsupported or malformed files.
+mtxMatrix readMatrixMarket(const std::string& path, unsigned threads = 0);
+
+// Read a file already in memory
+mtxMatrix readMatrixMarket(const char* begin, const char* end, unsigned threads = 0);
+
+#include "mtx.i++"
+
+#endif
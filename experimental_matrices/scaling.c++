@@ -0,0 +1,273 @@
+/*
+  Strong and weak scaling of the src/bench.fut entry points over thread
+  counts, for a multicore build of the benchmark program (make
+  ../src/bench-mc). The thread count is passed to the program as
+  --num-threads T, or whatever option -A names.
+
+  Strong scaling (the default) runs every MATRIX at every count. Weak
+  scaling (-W) takes one MATRIX per count, in the same order, so the
+  work should grow with the threads; matgen makes such series, e.g.
+  rmat at 2^20, 2^21, 2^22 for 1, 2, 4 threads.
+
+  For each entry point, speedup and parallel efficiency are relative to
+  the first count:
+
+    strong  speedup = t(first) / t(T)   efficiency = speedup * first / T
+    weak    efficiency = t(first) / t(T)   speedup = efficiency * T / first
+
+  and the curve "scales to" the largest count reached before efficiency
+  first falls below -k (default 0.5). Entry points built on
+  segmented_scan or segmented_reduce are marked, and listed together at
+  the end with where they stop scaling. Tables go to stderr, the curves
+  as JSON to stdout or -o FILE.
+
+  usage: scaling [-w warmup] [-r reps] [-j threads] [-e entries] [-T 1,2,4,...]
+                 [-W] [-k efficiency] [-A option] [-o FILE] PROGRAM MATRIX...
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "benchjson.h++"
+#include "benchrun.h++"
+
+using namespace std;
+
+struct point {
+  unsigned threads;
+  string matrix;
+  benchSummary s;
+  string error;
+  double speedup = 0;
+  double efficiency = 0;
+};
+
+struct curve {
+  const benchOperation* op;
+  vector<point> points;
+  unsigned scalesTo = 0;
+};
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [-w warmup] [-r reps] [-j threads] [-e entries] [-T 1,2,4,...]\n"
+          "          [-W] [-k efficiency] [-A option] [-o FILE] PROGRAM MATRIX...\n", prog);
+  exit(1);
+}
+
+// 1, 2, 4, ... below the number of cores, and the number of cores
+static vector<unsigned> defaultCounts() {
+  unsigned cores = max(1u, thread::hardware_concurrency());
+  vector<unsigned> res;
+  for (unsigned t = 1; t < cores; t *= 2) {
+    res.push_back(t);
+  }
+  res.push_back(cores);
+  return res;
+}
+
+static vector<unsigned> parseCounts(const char* s) {
+  vector<unsigned> res;
+  while (*s != '\0') {
+    char* end;
+    long t = strtol(s, &end, 10);
+    if (end == s || t <= 0) {
+      return {};
+    }
+    res.push_back((unsigned) t);
+    s = *end == ',' ? end + 1 : end;
+  }
+  return res;
+}
+
+static void finish(curve& c, bool weak, double minEfficiency) {
+  const point& base = c.points[0];
+  if (!base.error.empty()) {
+    return;
+  }
+  bool scaling = true;
+  for (point& p : c.points) {
+    if (!p.error.empty() || p.s.median <= 0) {
+      scaling = false;
+      continue;
+    }
+    double ratio = base.s.median / p.s.median;
+    double work = (double) p.threads / base.threads;
+    p.speedup = weak ? ratio * work : ratio;
+    p.efficiency = weak ? ratio : ratio / work;
+    scaling = scaling && p.efficiency >= minEfficiency;
+    if (scaling) {
+      c.scalesTo = p.threads;
+    }
+  }
+}
+
+static void printCurve(const curve& c, bool weak) {
+  fprintf(stderr, "%s %s%s\n", c.op->entry, c.op->segmented ? "(segmented) " : "",
+          weak ? "weak" : c.points[0].matrix.c_str());
+  for (const point& p : c.points) {
+    if (!p.error.empty()) {
+      fprintf(stderr, "  %4u threads  %-12s failed: %s\n", p.threads, p.matrix.c_str(), p.error.c_str());
+    } else {
+      fprintf(stderr, "  %4u threads  %-12s %10.0f us  speedup %6.2f  efficiency %5.2f\n",
+              p.threads, p.matrix.c_str(), p.s.median, p.speedup, p.efficiency);
+    }
+  }
+}
+
+static void writeCurve(FILE* out, const curve& c, bool first) {
+  fprintf(out, "%s\n    { \"entry\": %s, \"representation\": %s, \"operation\": %s, "
+          "\"segmented\": %s, \"scales_to\": %u,\n      \"points\": [",
+          first ? "" : ",", jsonQuote(c.op->entry).c_str(), jsonQuote(c.op->repr).c_str(),
+          jsonQuote(c.op->name).c_str(), c.op->segmented ? "true" : "false", c.scalesTo);
+  for (size_t i = 0; i < c.points.size(); i++) {
+    const point& p = c.points[i];
+    fprintf(out, "%s\n        { \"threads\": %u, \"matrix\": %s", i == 0 ? "" : ",",
+            p.threads, jsonQuote(p.matrix).c_str());
+    if (!p.error.empty()) {
+      fprintf(out, ", \"error\": %s }", jsonQuote(p.error).c_str());
+    } else {
+      fprintf(out, ", \"median_us\": %.1f, \"p95_us\": %.1f, \"speedup\": %.3f, \"efficiency\": %.3f }",
+              p.s.median, p.s.p95, p.speedup, p.efficiency);
+    }
+  }
+  fprintf(out, " ] }");
+}
+
+int main(int argc, char** argv) {
+  int warmup = 2;
+  int reps = 10;
+  unsigned threads = 0;
+  string only = "";
+  vector<unsigned> counts = defaultCounts();
+  bool weak = false;
+  double minEfficiency = 0.5;
+  string threadOption = "--num-threads";
+  string outPath = "";
+
+  int ch;
+  while ((ch = getopt(argc, argv, "w:r:j:e:T:Wk:A:o:")) != -1) {
+    switch (ch) {
+    case 'w': warmup = atoi(optarg); break;
+    case 'r': reps = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    case 'e': only = optarg; break;
+    case 'T': counts = parseCounts(optarg); break;
+    case 'W': weak = true; break;
+    case 'k': minEfficiency = atof(optarg); break;
+    case 'A': threadOption = optarg; break;
+    case 'o': outPath = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind + 2 > argc || warmup < 0 || reps < 1 || counts.empty()) {
+    usage(argv[0]);
+  }
+  string program = argv[optind++];
+  if (program.find('/') == string::npos) {
+    program = "./" + program;
+  }
+  vector<string> matrices(argv + optind, argv + argc);
+  if (weak && matrices.size() != counts.size()) {
+    fprintf(stderr, "weak scaling needs one matrix per thread count (%zu)\n", counts.size());
+    return 1;
+  }
+
+  vector<curve> curves;
+  int failures = 0;
+  try {
+    benchInputs inputs;
+    auto run = [&](curve& c, unsigned t, const string& matrix) {
+      point p;
+      p.threads = t;
+      p.matrix = baseName(matrix);
+      p.error = runBenchEntry(program, { threadOption, to_string(t) }, *c.op, inputs, warmup, reps, p.s);
+      failures += !p.error.empty();
+      c.points.push_back(p);
+    };
+
+    if (weak) {
+      for (const benchOperation& op : benchOperations()) {
+        if (benchSelected(only, op)) {
+          curves.push_back({ &op, {}, 0 });
+        }
+      }
+      for (size_t i = 0; i < counts.size(); i++) {
+        inputs.prepare(matrices[i], threads);
+        for (curve& c : curves) {
+          run(c, counts[i], matrices[i]);
+        }
+      }
+      for (curve& c : curves) {
+        finish(c, weak, minEfficiency);
+        printCurve(c, weak);
+      }
+    } else {
+      for (const string& matrix : matrices) {
+        inputs.prepare(matrix, threads);
+        for (const benchOperation& op : benchOperations()) {
+          if (!benchSelected(only, op)) {
+            continue;
+          }
+          curve c = { &op, {}, 0 };
+          for (unsigned t : counts) {
+            run(c, t, matrix);
+          }
+          finish(c, weak, minEfficiency);
+          printCurve(c, weak);
+          curves.push_back(c);
+        }
+      }
+    }
+  } catch (const exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  fprintf(stderr, "segmented scan/reduce entry points:\n");
+  for (const curve& c : curves) {
+    if (c.op->segmented) {
+      const point* drop = nullptr;
+      for (const point& p : c.points) {
+        if (p.threads > c.scalesTo && p.error.empty()) {
+          drop = &p;
+          break;
+        }
+      }
+      fprintf(stderr, "  %-16s %-12s scales to %u", c.op->entry,
+              weak ? "" : c.points[0].matrix.c_str(), c.scalesTo);
+      if (drop != nullptr) {
+        fprintf(stderr, ", efficiency %.2f at %u", drop->efficiency, drop->threads);
+      }
+      fprintf(stderr, "\n");
+    }
+  }
+
+  FILE* out = stdout;
+  if (outPath != "" && (out = fopen(outPath.c_str(), "w")) == nullptr) {
+    perror(outPath.c_str());
+    return 1;
+  }
+  fprintf(out, "{\n  \"program\": %s,\n  \"mode\": \"%s\",\n  \"warmup\": %d,\n  \"repetitions\": %d,\n"
+          "  \"min_efficiency\": %.2f,\n  \"cpus\": %u,\n  \"threads\": [",
+          jsonQuote(program).c_str(), weak ? "weak" : "strong", warmup, reps, minEfficiency,
+          thread::hardware_concurrency());
+  for (size_t i = 0; i < counts.size(); i++) {
+    fprintf(out, "%s%u", i == 0 ? "" : ", ", counts[i]);
+  }
+  fprintf(out, "],\n  \"curves\": [");
+  for (size_t i = 0; i < curves.size(); i++) {
+    writeCurve(out, curves[i], i == 0);
+  }
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+/*
+  A STREAM style measurement of the memory bandwidth of this host, the
+  roof of the roofline reports of benchsuite.
+
+  The triad a[i] = b[i] + s * c[i] runs over three arrays of doubles,
+  split between threads by index range, and the best of reps passes
+  counts. As in STREAM, a pass moves 24 bytes per element (two reads
+  and a write) and the write-allocate traffic is not counted. The arrays
+  should be several times the last level cache.
+*/
+
+#ifndef STREAM_HXX
+#define STREAM_HXX
+
+#include <cstddef>
+
+// Best triad bandwidth in GB/s (1e9 bytes per second) over arrays of
+// bytes bytes in all; threads 0 means one per core
+double streamTriad(size_t bytes, unsigned threads = 0, int reps = 10);
+
+#include "stream.i++"
+
+#endif
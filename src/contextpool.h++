@@ -0,0 +1,157 @@
+/*
+  A pool of independent contexts for serving requests from many threads,
+  over futhark.h++. Every call on a context takes its lock, so a single
+  context serialises its callers; with a pool, each request leases an
+  idle context of its own and calls on different contexts run in
+  parallel.
+
+  Each context gets a State made by the setup function given to make,
+  typically the arrays of a loaded matrix, copied into each context
+  with array::make.
+
+  Idle contexts are kept by index in a bounded lock-free queue. acquire
+  pops one, spinning and then yielding while all are busy, and the lease
+  pushes it back when it goes. stats() reports how long requests waited
+  for a context and what fraction of the pool's time was spent leased.
+
+    auto pool = futhark::contextPool<matrix>::make(8, loadMatrix);
+    auto lease = pool.value()->acquire();
+    auto res = tupleTest::entryMain(lease.context());
+*/
+
+#ifndef CONTEXTPOOL_HXX
+#define CONTEXTPOOL_HXX
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include "futhark.h++"
+
+namespace futhark {
+
+  // Bounded multi-producer multi-consumer queue after Vyukov: every cell
+  // has a sequence number that says whose turn it is, so push and pop
+  // claim a cell with one compare-and-swap and never block.
+  template <typename T>
+  class mpmcQueue {
+  public:
+    // capacity is rounded up to a power of two
+    explicit mpmcQueue(size_t capacity);
+
+    mpmcQueue(const mpmcQueue&) = delete;
+    mpmcQueue& operator=(const mpmcQueue&) = delete;
+
+    // False if full or empty respectively
+    bool push(T value);
+    bool pop(T& value);
+
+  private:
+    struct cell {
+      std::atomic<size_t> seq;
+      T value;
+    };
+
+    std::unique_ptr<cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+  };
+
+  struct contextPoolStats {
+    size_t contexts = 0;
+    uint64_t requests = 0;          // leases since creation or resetStats
+    double meanWaitUs = 0;          // from acquire until a context was free
+    double maxWaitUs = 0;
+    double utilization = 0;         // leased time over contexts * elapsed time
+    std::vector<double> busy;       // leased fraction of each context
+  };
+
+  template <typename State = std::monostate>
+  class contextPool {
+  public:
+    using setupFunction = std::function<result<State>(context&, size_t index)>;
+    using configFunction = std::function<void(config&)>;
+
+    // n contexts, each configured by configure and then given the State
+    // setup returns; fails with the first error of either
+    static result<std::unique_ptr<contextPool>> make(size_t n, setupFunction setup = nullptr,
+                                                     configFunction configure = nullptr);
+
+    contextPool(const contextPool&) = delete;
+    contextPool& operator=(const contextPool&) = delete;
+
+    // A context held until the lease goes, which must be before the pool
+    class lease {
+    public:
+      lease(lease&& other) noexcept : pool(other.pool), index(other.index), start(other.start) {
+        other.pool = nullptr;
+      }
+      lease& operator=(lease&&) = delete;
+      ~lease();
+
+      futhark::context& context() const { return pool->slots[index]->ctx; }
+      State& state() const { return pool->slots[index]->state; }
+      size_t slot() const { return index; }
+
+    private:
+      friend class contextPool;
+      lease(contextPool* pool, size_t index, std::chrono::steady_clock::time_point start)
+        : pool(pool), index(index), start(start) {}
+
+      contextPool* pool;
+      size_t index;
+      std::chrono::steady_clock::time_point start;
+    };
+
+    // Wait for an idle context and lease it
+    lease acquire();
+    // Lease an idle context if there is one
+    std::optional<lease> tryAcquire();
+
+    // f(context&, State&) on an idle context
+    template <typename F>
+    auto run(F&& f) {
+      lease l = acquire();
+      return f(l.context(), l.state());
+    }
+
+    size_t size() const { return slots.size(); }
+
+    contextPoolStats stats() const;
+    void resetStats();
+    void report(FILE* out) const;
+
+  private:
+    struct slot {
+      futhark::context ctx;
+      State state;
+      std::atomic<uint64_t> busyNs{ 0 };
+
+      slot(futhark::context ctx, State state) : ctx(std::move(ctx)), state(std::move(state)) {}
+    };
+
+    explicit contextPool(size_t n) : idle(n) {}
+
+    void release(size_t index, std::chrono::steady_clock::time_point start);
+    void waited(std::chrono::steady_clock::duration d);
+
+    std::vector<std::unique_ptr<slot>> slots;
+    mpmcQueue<size_t> idle;
+
+    std::atomic<int64_t> epochNs{ 0 };
+    std::atomic<uint64_t> requests{ 0 };
+    std::atomic<uint64_t> waitNs{ 0 };
+    std::atomic<uint64_t> maxWaitNs{ 0 };
+  };
+}
+
+#include "contextpool.i++"
+
+#endif
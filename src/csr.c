@@ -2,6 +2,10 @@
  * Headers
 */
 
+/* -std=c99 hides POSIX and Linux calls such as syscall */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -44,6 +48,37 @@ char *futhark_context_get_error(struct futhark_context *ctx);
 */
 
 void futhark_debugging_report(struct futhark_context *ctx);
+struct futhark_pool_stats {
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats);
+void futhark_context_pool_trim(struct futhark_context *ctx);
+struct futhark_memory_stats {
+    int64_t peak_bytes;
+    int64_t current_bytes;
+    int64_t allocations;
+    int64_t largest_allocation;
+} ;
+struct futhark_memory_record {
+    const char *entry_point;
+    int64_t bytes_before;
+    struct futhark_memory_stats stats;
+} ;
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats);
+void futhark_context_memory_reset(struct futhark_context *ctx);
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag);
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records);
+void futhark_context_clear_memory_records(struct futhark_context *ctx);
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag);
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path);
+void futhark_context_clear_trace(struct futhark_context *ctx);
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -111,6 +146,123 @@ static int64_t get_wall_time(void) {
 
 #endif
 
+/* Hardware performance counters around entry point calls, for
+   --perf-counters.  Each counter is opened on its own for this thread,
+   user space only, and read with its enabled and running times so that
+   a counter the kernel had to multiplex is scaled up.  A counter that
+   cannot be opened (no PMU, perf_event_paranoid, a container) is
+   reported as n/a and the others still work. */
+
+#define PERF_COUNTERS 4
+
+static const char *const perf_counter_names[PERF_COUNTERS] =
+  {"cycles", "instructions", "LLC-misses", "branch-misses"};
+
+struct perf_counters {
+  int fds[PERF_COUNTERS];
+  int64_t values[PERF_COUNTERS];
+};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void perf_counters_open(struct perf_counters *pc) {
+  static const uint64_t configs[PERF_COUNTERS] =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    pc->fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    uint64_t buf[3];
+    pc->values[i] = -1;
+    if (pc->fds[i] < 0) {
+      continue;
+    }
+    ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    if (read(pc->fds[i], buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0) {
+      pc->values[i] = buf[2] < buf[1] ? (int64_t)((double)buf[0] * buf[1] / buf[2]) : (int64_t)buf[0];
+    }
+  }
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      close(pc->fds[i]);
+    }
+    pc->fds[i] = -1;
+  }
+}
+
+#else
+
+static void perf_counters_open(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    pc->fds[i] = -1;
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  (void)pc;
+}
+
+#endif
+
+/* One line per measurement: what was measured, the wall time, and the
+   counters, with instructions per cycle when both are known. */
+static void perf_counters_report(FILE *out, const char *what, int64_t wall_usec,
+                                 const struct perf_counters *pc) {
+  fprintf(out, "%s: %lld us", what, (long long)wall_usec);
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->values[i] < 0) {
+      fprintf(out, ", %s n/a", perf_counter_names[i]);
+    } else {
+      fprintf(out, ", %s %lld", perf_counter_names[i], (long long)pc->values[i]);
+    }
+  }
+  if (pc->values[0] > 0 && pc->values[1] >= 0) {
+    fprintf(out, ", IPC %.2f", (double)pc->values[1] / pc->values[0]);
+  }
+  fputc('\n', out);
+}
+
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
@@ -556,51 +708,84 @@ static int write_str_bool(FILE *out, void *src) {
 // Reading little-endian byte sequences.  On big-endian hosts, we flip
 // the resulting bytes.
 
+static uint16_t bswap_2byte(uint16_t x) {
+  return (x>>8) | (x<<8);
+}
+
+static uint32_t bswap_4byte(uint32_t x) {
+  return
+    ((x>>24)&0xFF) |
+    ((x>>8) &0xFF00) |
+    ((x<<8) &0xFF0000) |
+    ((x<<24)&0xFF000000);
+}
+
+static uint64_t bswap_8byte(uint64_t x) {
+  return
+    ((x>>56)&0xFFull) |
+    ((x>>40)&0xFF00ull) |
+    ((x>>24)&0xFF0000ull) |
+    ((x>>8) &0xFF000000ull) |
+    ((x<<8) &0xFF00000000ull) |
+    ((x<<24)&0xFF0000000000ull) |
+    ((x<<40)&0xFF000000000000ull) |
+    ((x<<56)&0xFF00000000000000ull);
+}
+
+// Convert n little-endian elements in place to host byte order.  A
+// no-op on little-endian hosts.
+static void le_to_host(void* data, size_t elem_size, size_t n) {
+  if (!IS_BIG_ENDIAN) {
+    return;
+  }
+  switch (elem_size) {
+  case 2:
+    for (size_t i = 0; i < n; i++) {
+      ((uint16_t*)data)[i] = bswap_2byte(((uint16_t*)data)[i]);
+    }
+    break;
+  case 4:
+    for (size_t i = 0; i < n; i++) {
+      ((uint32_t*)data)[i] = bswap_4byte(((uint32_t*)data)[i]);
+    }
+    break;
+  case 8:
+    for (size_t i = 0; i < n; i++) {
+      ((uint64_t*)data)[i] = bswap_8byte(((uint64_t*)data)[i]);
+    }
+    break;
+  }
+}
+
+// Bytes and time spent in bulk binary reads, for --load-rate.
+static int64_t bin_bytes_read = 0;
+static int64_t bin_read_usec = 0;
+
+// Read n little-endian elements with a single fread, rather than one
+// libc call per element.  Returns the number of elements read.
+static size_t read_le_bulk(void* dest, size_t elem_size, size_t n) {
+  int64_t t_start = get_wall_time();
+  size_t num_elems_read = fread(dest, elem_size, n, stdin);
+  le_to_host(dest, elem_size, num_elems_read);
+  bin_read_usec += get_wall_time() - t_start;
+  bin_bytes_read += num_elems_read * elem_size;
+  return num_elems_read;
+}
+
 static int read_byte(void* dest) {
-  int num_elems_read = fread(dest, 1, 1, stdin);
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 1, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_2byte(void* dest) {
-  uint16_t x;
-  int num_elems_read = fread(&x, 2, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x = (x>>8) | (x<<8);
-  }
-  *(uint16_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 2, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_4byte(void* dest) {
-  uint32_t x;
-  int num_elems_read = fread(&x, 4, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>24)&0xFF) |
-      ((x>>8) &0xFF00) |
-      ((x<<8) &0xFF0000) |
-      ((x<<24)&0xFF000000);
-  }
-  *(uint32_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 4, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_8byte(void* dest) {
-  uint64_t x;
-  int num_elems_read = fread(&x, 8, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>56)&0xFFull) |
-      ((x>>40)&0xFF00ull) |
-      ((x>>24)&0xFF0000ull) |
-      ((x>>8) &0xFF000000ull) |
-      ((x<<8) &0xFF00000000ull) |
-      ((x<<24)&0xFF0000000000ull) |
-      ((x<<40)&0xFF000000000000ull) |
-      ((x<<56)&0xFF00000000000000ull);
-  }
-  *(uint64_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 8, 1) == 1 ? 0 : 1;
 }
 
 static int write_byte(void* dest) {
@@ -793,12 +978,12 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
 
   uint64_t elem_count = 1;
+  size_t num_dims_read = read_le_bulk(shape, sizeof(int64_t), dims);
+  if (num_dims_read != (size_t)dims) {
+    panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", (int)num_dims_read);
+  }
   for (int i=0; i<dims; i++) {
-    uint64_t bin_shape;
-    ret = read_le_8byte(&bin_shape);
-    if (ret != 0) { panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", i); }
-    elem_count *= bin_shape;
-    shape[i] = (int64_t) bin_shape;
+    elem_count *= (uint64_t) shape[i];
   }
 
   size_t elem_size = expected_type->size;
@@ -809,31 +994,30 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
   *data = tmp;
 
-  size_t num_elems_read = fread(*data, elem_size, elem_count, stdin);
+  size_t num_elems_read = read_le_bulk(*data, elem_size, elem_count);
   if (num_elems_read != elem_count) {
     panic(1, "binary-input: tried to read %i elements of an array, but only got %i elements.\n",
           elem_count, num_elems_read);
   }
 
-  // If we're on big endian platform we must change all multibyte elements
-  // from using little endian to big endian
-  if (IS_BIG_ENDIAN && elem_size != 1) {
-    char* elems = (char*) *data;
-    for (uint64_t i=0; i<elem_count; i++) {
-      char* elem = elems+(i*elem_size);
-      for (unsigned int j=0; j<elem_size/2; j++) {
-        char head = elem[j];
-        int tail_index = elem_size-1-j;
-        elem[j] = elem[tail_index];
-        elem[tail_index] = head;
-      }
-    }
-  }
-
   return 0;
 }
 
+/* Memory-mapped input file, see --mmap-input.  When set, values are read
+   from the mapping instead of stdin. */
+struct mapped_file ;
+static struct mapped_file *mapped_file_open(const char *path);
+static void mapped_file_close(struct mapped_file *mf);
+static int mapped_read_array(struct mapped_file *mf, const struct primtype_info_t *expected_type,
+                             void **data, int64_t *shape, int64_t dims);
+static int mapped_read_scalar(struct mapped_file *mf, const struct primtype_info_t *expected_type,
+                              void *dest);
+static struct mapped_file *mapped_input = NULL;
+
 static int read_array(const struct primtype_info_t *expected_type, void **data, int64_t *shape, int64_t dims) {
+  if (mapped_input != NULL) {
+    return mapped_read_array(mapped_input, expected_type, data, shape, dims);
+  }
   if (!read_is_binary()) {
     return read_str_array(expected_type->size, (str_reader)expected_type->read_str, expected_type->type_name, data, shape, dims);
   } else {
@@ -919,6 +1103,9 @@ static int write_array(FILE *out, int write_binary,
 }
 
 static int read_scalar(const struct primtype_info_t *expected_type, void *dest) {
+  if (mapped_input != NULL) {
+    return mapped_read_scalar(mapped_input, expected_type, dest);
+  }
   if (!read_is_binary()) {
     char buf[100];
     next_token(buf, sizeof(buf));
@@ -938,6 +1125,48 @@ static int write_scalar(FILE *out, int write_binary, const struct primtype_info_
 }
 
 static int binary_output = 0;
+static int report_load_rate = 0;
+static int perf_counting = 0;
+static const char *trace_file = NULL;
+static struct perf_counters perf_counters;
+/* Separate from the per-run counters, which every run restarts. */
+static struct perf_counters perf_counters_total;
+static int report_memory = 0;
+/* One line per entry point, with the worst call for each counter. */
+static void print_memory_report(struct futhark_context *ctx)
+{
+    const struct futhark_memory_record *rs;
+    int n = futhark_context_memory_records(ctx, &rs);
+    
+    for (int i = 0; i < n; i++) {
+        int first = 1, calls = 0;
+        struct futhark_memory_stats worst = {0, 0, 0, 0};
+        
+        for (int j = 0; j < n; j++) {
+            if (strcmp(rs[i].entry_point, rs[j].entry_point) != 0)
+                continue;
+            if (j < i) {
+                first = 0;
+                break;
+            }
+            calls++;
+            if (rs[j].stats.peak_bytes - rs[j].bytes_before >
+                worst.peak_bytes)
+                worst.peak_bytes = rs[j].stats.peak_bytes -
+                    rs[j].bytes_before;
+            if (rs[j].stats.allocations > worst.allocations)
+                worst.allocations = rs[j].stats.allocations;
+            if (rs[j].stats.largest_allocation > worst.largest_allocation)
+                worst.largest_allocation = rs[j].stats.largest_allocation;
+        }
+        if (first)
+            fprintf(stderr,
+                    "Entry point %s: %d calls, at most %lld bytes above the live set, %lld allocations, largest %lld bytes.\n",
+                    rs[i].entry_point, calls, (long long) worst.peak_bytes,
+                    (long long) worst.allocations,
+                    (long long) worst.largest_allocation);
+    }
+}
 static FILE *runtime_file;
 static int perform_warmup = 0;
 static int num_runs = 1;
@@ -954,7 +1183,13 @@ int parse_options(struct futhark_context_config *cfg, int argc,
                                            {"entry-point", required_argument,
                                             NULL, 5}, {"binary-output",
                                                        no_argument, NULL, 6},
-                                           {0, 0, 0, 0}};
+                                           {"load-rate", no_argument, NULL, 7},
+                                           {"mmap-input", required_argument,
+                                            NULL, 8}, {"memory-report",
+                                                       no_argument, NULL, 9},
+                                           {"perf-counters", no_argument, NULL,
+                                            10}, {"trace", required_argument,
+                                                  NULL, 11}, {0, 0, 0, 0}};
     
     while ((ch = getopt_long(argc, argv, ":t:r:DLe:b", long_options, NULL)) !=
            -1) {
@@ -977,6 +1212,19 @@ int parse_options(struct futhark_context_config *cfg, int argc,
             entry_point = optarg;
         if (ch == 6 || ch == 'b')
             binary_output = 1;
+        if (ch == 7)
+            report_load_rate = 1;
+        if (ch == 8) {
+            mapped_input = mapped_file_open(optarg);
+            if (mapped_input == NULL)
+                panic(1, "Cannot map %s: %s\n", optarg, strerror(errno));
+        }
+        if (ch == 9)
+            report_memory = 1;
+        if (ch == 10)
+            perf_counting = 1;
+        if (ch == 11)
+            trace_file = optarg;
         if (ch == ':')
             panic(-1, "Missing argument for option %s\n", argv[optind - 1]);
         if (ch == '?')
@@ -1008,6 +1256,14 @@ int main(int argc, char **argv)
     struct futhark_context *ctx = futhark_context_new(cfg);
     
     assert(ctx != NULL);
+    if (report_memory)
+        futhark_context_set_memory_recording(ctx, 1);
+    if (trace_file != NULL)
+        futhark_context_set_tracing(ctx, 1);
+    if (perf_counting) {
+        perf_counters_open(&perf_counters);
+        perf_counters_open(&perf_counters_total);
+    }
     
     int num_entry_points = sizeof(entry_points) / sizeof(entry_points[0]);
     entry_point_fun *entry_point_fun = NULL;
@@ -1026,12 +1282,42 @@ int main(int argc, char **argv)
             fprintf(stderr, "%s\n", entry_points[i].name);
         return 1;
     }
+    
+    int64_t entry_start = get_wall_time();
+    
+    if (perf_counting)
+        perf_counters_start(&perf_counters_total);
     entry_point_fun(ctx);
+    if (perf_counting) {
+        perf_counters_stop(&perf_counters_total);
+        
+        char what[256];
+        
+        snprintf(what, sizeof(what), "Entry point %s, all runs and I/O",
+                 entry_point);
+        perf_counters_report(stderr, what, get_wall_time() - entry_start,
+                             &perf_counters_total);
+        perf_counters_close(&perf_counters_total);
+        perf_counters_close(&perf_counters);
+    }
     if (runtime_file != NULL)
         fclose(runtime_file);
+    if (trace_file != NULL && futhark_context_write_trace(ctx, trace_file) != 0)
+        panic(1, "Cannot write trace to %s: %s\n", trace_file,
+              strerror(errno));
+    if (report_load_rate)
+        fprintf(stderr,
+                "Read %lld bytes of binary input in %lld us (%.2f MB/s).\n",
+                (long long) bin_bytes_read, (long long) bin_read_usec,
+                bin_read_usec == 0 ? 0.0 : (double) bin_bytes_read /
+                bin_read_usec);
+    if (report_memory)
+        print_memory_report(ctx);
     futhark_debugging_report(ctx);
     futhark_context_free(ctx);
     futhark_context_config_free(cfg);
+    if (mapped_input != NULL)
+        mapped_file_close(mapped_input);
     return 0;
 }
 #ifdef _MSC_VER
@@ -1106,6 +1392,22 @@ struct memblock {
     int64_t size;
     const char *desc;
 } ;
+/* Size-class pool behind memblock_alloc.  Class 0 holds blocks of up to
+   16 bytes, and after that every power of two is split into four
+   classes, so at most a fifth of a block is slack.  Freed blocks go on
+   the free list of their class instead of back to malloc, and are handed
+   out again by the next allocation of that class.  The reference count
+   and the free list link live in a header in front of the block, so in
+   the steady state of a loop nothing is allocated at all. */
+#define MEMBLOCK_POOL_CLASSES 256
+#define MEMBLOCK_HEADER 16
+struct memblock_pool {
+    char *free[MEMBLOCK_POOL_CLASSES];
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
 struct futhark_context_config {
     int debugging;
 } ;
@@ -1135,6 +1437,14 @@ void futhark_context_config_set_logging(struct futhark_context_config *cfg,
     cfg = cfg;
     detail = detail;
 }
+struct trace_event {
+    const char *cat;
+    const char *name;
+    int64_t start;
+    int64_t end;
+    int64_t allocated;
+    int64_t live;
+} ;
 struct futhark_context {
     int detail_memory;
     int debugging;
@@ -1142,6 +1452,16 @@ struct futhark_context {
     char *error;
     int64_t peak_mem_usage_default;
     int64_t cur_mem_usage_default;
+    struct memblock_pool pool;
+    int64_t num_allocs_default;
+    int64_t largest_alloc_default;
+    int record_memory;
+    struct futhark_memory_record *memory_records;
+    int num_memory_records;
+    int64_t alloc_bytes_default;
+    int tracing;
+    struct trace_event *trace_events;
+    int num_trace_events;
 } ;
 struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
 {
@@ -1155,10 +1475,24 @@ struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
     create_lock(&ctx->lock);
     ctx->peak_mem_usage_default = 0;
     ctx->cur_mem_usage_default = 0;
+    memset(&ctx->pool, 0, sizeof(ctx->pool));
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    ctx->record_memory = 0;
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    ctx->alloc_bytes_default = 0;
+    ctx->tracing = 0;
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
     return ctx;
 }
+static void memblock_pool_trim(struct futhark_context *ctx);
 void futhark_context_free(struct futhark_context *ctx)
 {
+    memblock_pool_trim(ctx);
+    free(ctx->memory_records);
+    free(ctx->trace_events);
     free_lock(&ctx->lock);
     free(ctx);
 }
@@ -1174,6 +1508,89 @@ char *futhark_context_get_error(struct futhark_context *ctx)
     ctx->error = NULL;
     return error;
 }
+static int memblock_class(int64_t size)
+{
+    if (size <= 16)
+        return 0;
+    
+    int k = 4;
+    
+    while (((int64_t) 1 << (k + 1)) < size)
+        k++;
+    
+    int64_t step = (int64_t) 1 << (k - 2);
+    int64_t q = (size + step - 1) / step;
+    
+    return 4 * (k - 4) + (int) (q - 4);
+}
+static int64_t memblock_class_size(int c)
+{
+    if (c == 0)
+        return 16;
+    return (int64_t) (5 + (c - 1) % 4) << (4 + (c - 1) / 4 - 2);
+}
+static char **memblock_pool_link(char *raw)
+{
+    return (char **) (raw + sizeof(int64_t));
+}
+static char *memblock_pool_get(struct futhark_context *ctx, int64_t size)
+{
+    int c = memblock_class(size);
+    char *raw = ctx->pool.free[c];
+    
+    if (raw != NULL) {
+        ctx->pool.free[c] = *memblock_pool_link(raw);
+        ctx->pool.hits++;
+        ctx->pool.bytes_retained -= memblock_class_size(c);
+        ctx->pool.blocks_retained--;
+    } else {
+        raw = malloc(MEMBLOCK_HEADER + memblock_class_size(c));
+        if (raw == NULL)
+            panic(1, "Failed to allocate %lld bytes in %s.\n", (long long) size,
+                  "default space");
+        ctx->pool.misses++;
+    }
+    return raw;
+}
+static void memblock_pool_put(struct futhark_context *ctx, char *raw,
+                              int64_t size)
+{
+    int c = memblock_class(size);
+    
+    *memblock_pool_link(raw) = ctx->pool.free[c];
+    ctx->pool.free[c] = raw;
+    ctx->pool.bytes_retained += memblock_class_size(c);
+    ctx->pool.blocks_retained++;
+}
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    stats->hits = ctx->pool.hits;
+    stats->misses = ctx->pool.misses;
+    stats->bytes_retained = ctx->pool.bytes_retained;
+    stats->blocks_retained = ctx->pool.blocks_retained;
+    lock_unlock(&ctx->lock);
+}
+static void memblock_pool_trim(struct futhark_context *ctx)
+{
+    for (int c = 0; c < MEMBLOCK_POOL_CLASSES; c++) {
+        while (ctx->pool.free[c] != NULL) {
+            char *raw = ctx->pool.free[c];
+            
+            ctx->pool.free[c] = *memblock_pool_link(raw);
+            free(raw);
+        }
+    }
+    ctx->pool.bytes_retained = 0;
+    ctx->pool.blocks_retained = 0;
+}
+void futhark_context_pool_trim(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    memblock_pool_trim(ctx);
+    lock_unlock(&ctx->lock);
+}
 static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                           const char *desc)
 {
@@ -1185,8 +1602,7 @@ static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                     desc, block->desc, "default space", *block->references);
         if (*block->references == 0) {
             ctx->cur_mem_usage_default -= block->size;
-            free(block->mem);
-            free(block->references);
+            memblock_pool_put(ctx, (char *) block->references, block->size);
             if (ctx->detail_memory)
                 fprintf(stderr,
                         "%lld bytes freed (now allocated: %lld bytes)\n",
@@ -1207,12 +1623,18 @@ static int memblock_alloc(struct futhark_context *ctx, struct memblock *block,
     
     int ret = memblock_unref(ctx, block, desc);
     
-    block->mem = (char *) malloc(size);
-    block->references = (int *) malloc(sizeof(int));
+    char *raw = memblock_pool_get(ctx, size);
+    
+    block->references = (int *) raw;
+    block->mem = raw + MEMBLOCK_HEADER;
     *block->references = 1;
     block->size = size;
     block->desc = desc;
     ctx->cur_mem_usage_default += size;
+    ctx->num_allocs_default++;
+    ctx->alloc_bytes_default += size;
+    if (size > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = size;
     if (ctx->detail_memory)
         fprintf(stderr,
                 "Allocated %lld bytes for %s in %s (now allocated: %lld bytes)",
@@ -1235,11 +1657,366 @@ static int memblock_set(struct futhark_context *ctx, struct memblock *lhs,
     *lhs = *rhs;
     return ret;
 }
+/* Memory-mapped input.  A file of Futhark binary values is mapped
+   read-only and parsed in place, so values are copied straight out of
+   the page cache with no stdio buffering in between.  Every value is
+   still copied once into the memory read_array hands back, as with
+   stdin. */
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct mapped_file {
+    char *data;
+    int64_t size;
+    int64_t pos;
+} ;
+static struct mapped_file *mapped_file_open(const char *path)
+{
+#ifdef _WIN32
+    path = path;
+    errno = ENOSYS;
+    return NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    
+    if (fd < 0)
+        return NULL;
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    
+    void *data = st.st_size == 0 ? NULL : mmap(NULL, st.st_size,
+                                               PROT_READ, MAP_PRIVATE, fd,
+                                               0);
+    
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+    
+    struct mapped_file *mf = malloc(sizeof(struct mapped_file));
+    
+    if (mf == NULL)
+        return NULL;
+    mf->data = data;
+    mf->size = st.st_size;
+    mf->pos = 0;
+    return mf;
+#endif
+}
+static void mapped_file_close(struct mapped_file *mf)
+{
+#ifndef _WIN32
+    if (mf->data != NULL)
+        munmap(mf->data, mf->size);
+#endif
+    free(mf);
+}
+static void mapped_file_need(struct mapped_file *mf, int64_t n)
+{
+    if (mf->pos + n > mf->size)
+        panic(1,
+              "mapped-input: Unexpected end of file at offset %lld.\n",
+              (long long) mf->pos);
+}
+/* Parse the header of the next binary array in the mapping, leaving pos
+   at the start of its payload.  Returns the number of elements. */
+static int64_t mapped_read_header(struct mapped_file *mf,
+                                  const struct primtype_info_t *expected_type,
+                                  int64_t *shape, int64_t dims)
+{
+    while (mf->pos < mf->size && isspace(mf->data[mf->pos]))
+        mf->pos++;
+    mapped_file_need(mf, 7);
+    if (mf->data[mf->pos] != 'b')
+        panic(1, "mapped-input: Expected binary value at offset %lld.\n",
+              (long long) mf->pos);
+    if (mf->data[mf->pos + 1] != BINARY_FORMAT_VERSION)
+        panic(1,
+              "mapped-input: File uses version %i, but I only understand version %i.\n",
+              mf->data[mf->pos + 1], BINARY_FORMAT_VERSION);
+    if (mf->data[mf->pos + 2] != dims)
+        panic(1,
+              "mapped-input: Expected %i dimensions, but got array with %i dimensions.\n",
+              (int) dims, mf->data[mf->pos + 2]);
+    if (memcmp(mf->data + mf->pos + 3, expected_type->binname, 4) != 0)
+        panic(1,
+              "mapped-input: Expected %iD-array with element type '%s' but got '%.4s'.\n",
+              (int) dims, expected_type->type_name, mf->data + mf->pos + 3);
+    mf->pos += 7;
+    mapped_file_need(mf, dims * sizeof(int64_t));
+    memcpy(shape, mf->data + mf->pos, dims * sizeof(int64_t));
+    le_to_host(shape, sizeof(int64_t), dims);
+    mf->pos += dims * sizeof(int64_t);
+    
+    int64_t elem_count = 1;
+    int64_t max_count = (mf->size - mf->pos) / expected_type->size;
+    
+    for (int i = 0; i < dims; i++) {
+        if (shape[i] < 0)
+            panic(1, "mapped-input: Negative size %lld for dimension %i.\n",
+                  (long long) shape[i], i);
+        if (shape[i] != 0 && elem_count > max_count / shape[i])
+            panic(1,
+                  "mapped-input: Array at offset %lld does not fit in the file.\n",
+                  (long long) mf->pos);
+        elem_count *= shape[i];
+    }
+    mapped_file_need(mf, elem_count * expected_type->size);
+    return elem_count;
+}
+/* Copy the next array in the mapping into *data, which is reallocated
+   like read_array does. */
+static int mapped_read_array(struct mapped_file *mf,
+                             const struct primtype_info_t *expected_type,
+                             void **data, int64_t *shape, int64_t dims)
+{
+    int64_t elem_count = mapped_read_header(mf, expected_type, shape, dims);
+    int64_t size = elem_count * expected_type->size;
+    void *tmp = realloc(*data, size);
+    
+    if (tmp == NULL && size != 0)
+        panic(1, "mapped-input: Failed to allocate array of size %lld.\n",
+              (long long) size);
+    *data = tmp;
+    memcpy(*data, mf->data + mf->pos, size);
+    le_to_host(*data, expected_type->size, elem_count);
+    mf->pos += size;
+    return 0;
+}
+static int mapped_read_scalar(struct mapped_file *mf,
+                              const struct primtype_info_t *expected_type,
+                              void *dest)
+{
+    int64_t shape[1];
+    
+    mapped_read_header(mf, expected_type, shape, 0);
+    memcpy(dest, mf->data + mf->pos, expected_type->size);
+    le_to_host(dest, expected_type->size, 1);
+    mf->pos += expected_type->size;
+    return 0;
+}
+/* Memory counters.  Peak, allocation count and largest allocation run
+   from context creation or the last futhark_context_memory_reset.  With
+   recording on, every entry point call also gets a record of its own:
+   the counters are zeroed when the call starts, copied into the record
+   when it returns, and then folded back into the running totals. */
+static void memory_stats_get(struct futhark_context *ctx,
+                             struct futhark_memory_stats *stats)
+{
+    stats->peak_bytes = ctx->peak_mem_usage_default;
+    stats->current_bytes = ctx->cur_mem_usage_default;
+    stats->allocations = ctx->num_allocs_default;
+    stats->largest_allocation = ctx->largest_alloc_default;
+}
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    memory_stats_get(ctx, stats);
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_memory_reset(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->record_memory = flag;
+    lock_unlock(&ctx->lock);
+}
+/* The records point into the context's own array, which the next
+   recorded entry point call may move, and which
+   futhark_context_clear_memory_records frees.  Copy them out before
+   calling into the context again. */
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records)
+{
+    lock_lock(&ctx->lock);
+    
+    int n = ctx->num_memory_records;
+    
+    *records = ctx->memory_records;
+    lock_unlock(&ctx->lock);
+    return n;
+}
+void futhark_context_clear_memory_records(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->memory_records);
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    lock_unlock(&ctx->lock);
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void memory_record_begin(struct futhark_context *ctx,
+                                struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    memory_stats_get(ctx, saved);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void memory_record_end(struct futhark_context *ctx, const char *entry,
+                              const struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    
+    int n = ctx->num_memory_records;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct futhark_memory_record *grown =
+                                     realloc(ctx->memory_records, (n == 0 ? 1 :
+                                                                   2 * n) *
+                                             sizeof(struct futhark_memory_record));
+        
+        if (grown == NULL)
+            panic(1, "Failed to record memory use of %s.\n", entry);
+        ctx->memory_records = grown;
+    }
+    
+    struct futhark_memory_record *r = &ctx->memory_records[n];
+    
+    r->entry_point = entry;
+    r->bytes_before = saved->current_bytes;
+    memory_stats_get(ctx, &r->stats);
+    ctx->num_memory_records = n + 1;
+    if (saved->peak_bytes > ctx->peak_mem_usage_default)
+        ctx->peak_mem_usage_default = saved->peak_bytes;
+    ctx->num_allocs_default += saved->allocations;
+    if (saved->largest_allocation > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = saved->largest_allocation;
+}
+/* Tracing.  With tracing on, every entry point call is recorded with its
+   wall time, the bytes allocated while it ran and the bytes live when it
+   finished, and futhark_context_write_trace writes them as Chrome
+   trace-event JSON.  Only the entry point boundary is traced: phases
+   inside a body have no source names here and would be lost when the
+   program is regenerated, so make an operation its own entry point to
+   see it on the timeline. */
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->tracing = flag;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_clear_trace(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->trace_events);
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
+    lock_unlock(&ctx->lock);
+}
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path)
+{
+    FILE *out = fopen(path, "w");
+    
+    if (out == NULL)
+        return 1;
+    lock_lock(&ctx->lock);
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    
+    int first = 1;
+    
+    for (int i = 0; i < ctx->num_trace_events; i++) {
+        struct trace_event *e = &ctx->trace_events[i];
+        
+        if (e->end < 0)
+            continue;
+        fprintf(out,
+                "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %lld, \"dur\": %lld, \"args\": {\"allocated_bytes\": %lld, \"live_bytes\": %lld}},\n{\"name\": \"memory\", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, \"args\": {\"live_bytes\": %lld}}",
+                first ? "" : ",", e->name, e->cat, (long long) e->start,
+                (long long) (e->end - e->start), (long long) e->allocated,
+                (long long) e->live, (long long) e->end, (long long) e->live);
+        first = 0;
+    }
+    fprintf(out, "\n]}\n");
+    lock_unlock(&ctx->lock);
+    return fclose(out) != 0;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static int trace_begin(struct futhark_context *ctx, const char *cat,
+                       const char *name)
+{
+    if (!ctx->tracing)
+        return -1;
+    
+    int n = ctx->num_trace_events;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct trace_event *grown = realloc(ctx->trace_events, (n == 0 ? 1 :
+                                                                2 * n) *
+                                            sizeof(struct trace_event));
+        
+        if (grown == NULL)
+            panic(1, "Failed to trace %s.\n", name);
+        ctx->trace_events = grown;
+    }
+    
+    struct trace_event *e = &ctx->trace_events[n];
+    
+    e->cat = cat;
+    e->name = name;
+    e->end = -1;
+    e->allocated = ctx->alloc_bytes_default;
+    e->start = get_wall_time();
+    ctx->num_trace_events = n + 1;
+    return n;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void trace_end(struct futhark_context *ctx, int event)
+{
+    if (event < 0)
+        return;
+    
+    struct trace_event *e = &ctx->trace_events[event];
+    
+    e->end = get_wall_time();
+    e->allocated = ctx->alloc_bytes_default - e->allocated;
+    e->live = ctx->cur_mem_usage_default;
+}
 void futhark_debugging_report(struct futhark_context *ctx)
 {
     if (ctx->detail_memory) {
         fprintf(stderr, "Peak memory usage for default space: %lld bytes.\n",
                 (long long) ctx->peak_mem_usage_default);
+        fprintf(stderr,
+                "%lld allocations, the largest %lld bytes.\n",
+                (long long) ctx->num_allocs_default,
+                (long long) ctx->largest_alloc_default);
+        fprintf(stderr,
+                "Memory pool: %lld hits, %lld misses, %lld bytes retained in %lld blocks.\n",
+                (long long) ctx->pool.hits, (long long) ctx->pool.misses,
+                (long long) ctx->pool.bytes_retained,
+                (long long) ctx->pool.blocks_retained);
     }
     if (ctx->debugging) { }
 }
@@ -0,0 +1,276 @@
+/*
+  C++17 ownership and error handling for the C API of a compiled Futhark
+  program. A program's own wrapper (tupleTest.h++) includes its C header
+  in extern "C", then this file, then wraps its entry points.
+
+  config, context, array and opaque own one C object each and free it
+  when they go; they can be moved but not copied. An array or opaque
+  keeps a pointer to its context, which must outlive it, and a context
+  owns the config it was made from. Calls that can fail return a
+  result<T>, holding either the value or the error: the code the C
+  function returned and the message futhark_context_get_error had.
+
+  The C API has one set of functions per element type and rank, and one
+  per opaque type. array<T, RANK> finds them through array_traits, which
+  FUTHARK_ARRAY(name, T, RANK) defines, so FUTHARK_ARRAY(i32, int32_t, 1)
+  makes array<int32_t, 1> use struct futhark_i32_1d. FUTHARK_OPAQUE(name)
+  does the same for struct futhark_opaque_name. Both go at global scope.
+
+  Results can be read without a copy: view takes over an array and
+  lends out its elements (futhark_values_raw_*) for as long as the view
+  lives. span is std::span from C++20, and a stand-in with the same
+  interface before.
+*/
+
+#ifndef FUTHARK_HXX
+#define FUTHARK_HXX
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+namespace futhark {
+
+#if __cplusplus >= 202002L
+  template <typename T> using span = std::span<T>;
+#else
+  template <typename T>
+  class span {
+  public:
+    constexpr span() = default;
+    constexpr span(T* data, size_t size) : ptr(data), len(size) {}
+    // From a vector or anything else with data() and size()
+    template <typename C, typename = decltype(std::declval<C&>().data())>
+    constexpr span(C& c) : ptr(c.data()), len(c.size()) {}
+
+    constexpr T* data() const { return ptr; }
+    constexpr size_t size() const { return len; }
+    constexpr bool empty() const { return len == 0; }
+    constexpr T* begin() const { return ptr; }
+    constexpr T* end() const { return ptr + len; }
+    constexpr T& operator[](size_t i) const { return ptr[i]; }
+
+  private:
+    T* ptr = nullptr;
+    size_t len = 0;
+  };
+#endif
+
+  struct error {
+    int code = 0;
+    std::string message;
+  };
+
+  template <typename T>
+  class result {
+  public:
+    result(T value) : v(std::move(value)) {}
+    result(futhark::error e) : v(std::move(e)) {}
+
+    bool ok() const { return v.index() == 0; }
+    explicit operator bool() const { return ok(); }
+
+    // std::bad_variant_access if this is an error
+    T& value() & { return std::get<0>(v); }
+    T&& value() && { return std::get<0>(std::move(v)); }
+
+    const futhark::error& error() const { return std::get<1>(v); }
+
+  private:
+    std::variant<T, futhark::error> v;
+  };
+
+  template <>
+  class result<void> {
+  public:
+    result() = default;
+    result(futhark::error e) : failed(true), e(std::move(e)) {}
+
+    bool ok() const { return !failed; }
+    explicit operator bool() const { return ok(); }
+
+    const futhark::error& error() const { return e; }
+
+  private:
+    bool failed = false;
+    futhark::error e;
+  };
+
+  class config {
+  public:
+    static result<config> make();
+
+    void setDebugging(bool flag);
+    void setLogging(bool flag);
+
+    futhark_context_config* get() const { return cfg.get(); }
+
+  private:
+    struct deleter {
+      void operator()(futhark_context_config* cfg) const { futhark_context_config_free(cfg); }
+    };
+
+    explicit config(futhark_context_config* cfg) : cfg(cfg) {}
+
+    std::unique_ptr<futhark_context_config, deleter> cfg;
+  };
+
+  class context {
+  public:
+    static result<context> make(config cfg);
+
+    futhark_context* get() const { return ctx.get(); }
+
+    // The error behind code, the nonzero result of a call on this context
+    futhark::error takeError(int code);
+    // Empty if code is zero, else takeError(code)
+    result<void> check(int code);
+
+    result<void> sync();
+
+    futhark_memory_stats memoryStats() const;
+    void memoryReset();
+    void setMemoryRecording(bool flag);
+    std::vector<futhark_memory_record> memoryRecords() const;
+    void clearMemoryRecords();
+
+    futhark_pool_stats poolStats() const;
+    void poolTrim();
+
+    void setTracing(bool flag);
+    result<void> writeTrace(const std::string& path);
+    void clearTrace();
+
+  private:
+    struct deleter {
+      void operator()(futhark_context* ctx) const { futhark_context_free(ctx); }
+    };
+
+    context(config cfg, futhark_context* ctx) : cfg(std::move(cfg)), ctx(ctx) {}
+
+    // Declared first so that it goes after the context
+    config cfg;
+    std::unique_ptr<futhark_context, deleter> ctx;
+  };
+
+  // Specialised by FUTHARK_ARRAY and FUTHARK_OPAQUE
+  template <typename T, int RANK> struct array_traits;
+  template <typename C> struct opaque_traits;
+
+  template <typename T, int RANK>
+  class array {
+  public:
+    using traits = array_traits<T, RANK>;
+    using c_type = typename traits::c_type;
+
+    // A copy of the row-major data of the given shape
+    static result<array> make(context& ctx, const T* data, const std::array<int64_t, RANK>& shape);
+    static result<array> make(context& ctx, const std::vector<T>& data, const std::array<int64_t, RANK>& shape) {
+      return make(ctx, data.data(), shape);
+    }
+
+    // Take ownership of arr, say as returned by an entry point
+    array(context& ctx, c_type* arr) : arr(arr, deleter{ ctx.get() }) {}
+
+    std::array<int64_t, RANK> shape() const;
+    int64_t size() const;
+
+    result<std::vector<T>> values() const;
+
+    c_type* get() const { return arr.get(); }
+    c_type* release() { return arr.release(); }
+    futhark_context* owner() const { return arr.get_deleter().ctx; }
+
+  private:
+    struct deleter {
+      futhark_context* ctx;
+      void operator()(c_type* arr) const { traits::free(ctx, arr); }
+    };
+
+    std::unique_ptr<c_type, deleter> arr;
+  };
+
+  // An array and a read-only span of its elements, valid while the view is
+  template <typename T, int RANK>
+  class view {
+  public:
+    static result<view> make(array<T, RANK> arr);
+
+    span<const T> data() const { return elems; }
+    const std::array<int64_t, RANK>& shape() const { return dims; }
+    const array<T, RANK>& source() const { return arr; }
+
+  private:
+    view(array<T, RANK> arr, span<const T> elems)
+      : arr(std::move(arr)), elems(elems), dims(this->arr.shape()) {}
+
+    array<T, RANK> arr;
+    span<const T> elems;
+    std::array<int64_t, RANK> dims;
+  };
+
+  template <typename C>
+  class opaque {
+  public:
+    opaque(context& ctx, C* obj) : obj(obj, deleter{ ctx.get() }) {}
+
+    C* get() const { return obj.get(); }
+    C* release() { return obj.release(); }
+
+  private:
+    struct deleter {
+      futhark_context* ctx;
+      void operator()(C* obj) const { opaque_traits<C>::free(ctx, obj); }
+    };
+
+    std::unique_ptr<C, deleter> obj;
+  };
+}
+
+#define FUTHARK_ARRAY(name, T, RANK)                                          \
+  namespace futhark {                                                         \
+    template <>                                                               \
+    struct array_traits<T, RANK> {                                            \
+      using c_type = futhark_##name##_##RANK##d;                              \
+      template <typename... Dims>                                             \
+      static c_type* make(futhark_context* ctx, const T* data, Dims... dims) { \
+        return futhark_new_##name##_##RANK##d(ctx, const_cast<T*>(data), dims...); \
+      }                                                                       \
+      static int free(futhark_context* ctx, c_type* arr) {                    \
+        return futhark_free_##name##_##RANK##d(ctx, arr);                     \
+      }                                                                       \
+      static int values(futhark_context* ctx, c_type* arr, T* data) {         \
+        return futhark_values_##name##_##RANK##d(ctx, arr, data);             \
+      }                                                                       \
+      static const int64_t* shape(futhark_context* ctx, c_type* arr) {        \
+        return futhark_shape_##name##_##RANK##d(ctx, arr);                    \
+      }                                                                       \
+      /* A template, so that a program without it is fine until used */       \
+      template <typename C>                                                   \
+      static const T* raw(futhark_context* ctx, C* arr) {                     \
+        return (const T*) futhark_values_raw_##name##_##RANK##d(ctx, arr);    \
+      }                                                                       \
+    };                                                                        \
+  }
+
+#define FUTHARK_OPAQUE(name)                                                  \
+  namespace futhark {                                                         \
+    template <>                                                               \
+    struct opaque_traits<futhark_opaque_##name> {                             \
+      static int free(futhark_context* ctx, futhark_opaque_##name* obj) {     \
+        return futhark_free_opaque_##name(ctx, obj);                          \
+      }                                                                       \
+    };                                                                        \
+  }
+
+#include "futhark.i++"
+
+#endif
@@ -2,6 +2,10 @@
  * Headers
 */
 
+/* -std=c99 hides POSIX and Linux calls such as syscall */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -28,6 +32,19 @@ char *futhark_context_get_error(struct futhark_context *ctx);
  * Arrays
 */
 
+struct futhark_i32_1d ;
+struct futhark_i32_1d *futhark_new_i32_1d(struct futhark_context *ctx,
+                                          int32_t *data, int dim0);
+struct futhark_i32_1d *futhark_new_raw_i32_1d(struct futhark_context *ctx,
+                                              char *data, int offset, int dim0);
+int futhark_free_i32_1d(struct futhark_context *ctx,
+                        struct futhark_i32_1d *arr);
+int futhark_values_i32_1d(struct futhark_context *ctx,
+                          struct futhark_i32_1d *arr, int32_t *data);
+char *futhark_values_raw_i32_1d(struct futhark_context *ctx,
+                                struct futhark_i32_1d *arr);
+int64_t *futhark_shape_i32_1d(struct futhark_context *ctx,
+                              struct futhark_i32_1d *arr);
 
 /*
  * Opaque values
@@ -38,12 +55,57 @@ char *futhark_context_get_error(struct futhark_context *ctx);
  * Entry points
 */
 
+int futhark_entry_coo_get(struct futhark_context *ctx, int32_t *out0, const
+                          int32_t in0, const int32_t in1, const
+                          struct futhark_i32_1d *in2, const
+                          struct futhark_i32_1d *in3, const
+                          struct futhark_i32_1d *in4, const int32_t in5, const
+                          int32_t in6);
+int futhark_entry_coo_transpose(struct futhark_context *ctx, int32_t *out0,
+                                int32_t *out1, struct futhark_i32_1d **out2,
+                                struct futhark_i32_1d **out3,
+                                struct futhark_i32_1d **out4, const
+                                int32_t in0, const int32_t in1, const
+                                struct futhark_i32_1d *in2, const
+                                struct futhark_i32_1d *in3, const
+                                struct futhark_i32_1d *in4);
 
 /*
  * Miscellaneous
 */
 
 void futhark_debugging_report(struct futhark_context *ctx);
+struct futhark_pool_stats {
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats);
+void futhark_context_pool_trim(struct futhark_context *ctx);
+struct futhark_memory_stats {
+    int64_t peak_bytes;
+    int64_t current_bytes;
+    int64_t allocations;
+    int64_t largest_allocation;
+} ;
+struct futhark_memory_record {
+    const char *entry_point;
+    int64_t bytes_before;
+    struct futhark_memory_stats stats;
+} ;
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats);
+void futhark_context_memory_reset(struct futhark_context *ctx);
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag);
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records);
+void futhark_context_clear_memory_records(struct futhark_context *ctx);
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag);
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path);
+void futhark_context_clear_trace(struct futhark_context *ctx);
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -111,6 +173,123 @@ static int64_t get_wall_time(void) {
 
 #endif
 
+/* Hardware performance counters around entry point calls, for
+   --perf-counters.  Each counter is opened on its own for this thread,
+   user space only, and read with its enabled and running times so that
+   a counter the kernel had to multiplex is scaled up.  A counter that
+   cannot be opened (no PMU, perf_event_paranoid, a container) is
+   reported as n/a and the others still work. */
+
+#define PERF_COUNTERS 4
+
+static const char *const perf_counter_names[PERF_COUNTERS] =
+  {"cycles", "instructions", "LLC-misses", "branch-misses"};
+
+struct perf_counters {
+  int fds[PERF_COUNTERS];
+  int64_t values[PERF_COUNTERS];
+};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void perf_counters_open(struct perf_counters *pc) {
+  static const uint64_t configs[PERF_COUNTERS] =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    pc->fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    uint64_t buf[3];
+    pc->values[i] = -1;
+    if (pc->fds[i] < 0) {
+      continue;
+    }
+    ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    if (read(pc->fds[i], buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0) {
+      pc->values[i] = buf[2] < buf[1] ? (int64_t)((double)buf[0] * buf[1] / buf[2]) : (int64_t)buf[0];
+    }
+  }
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      close(pc->fds[i]);
+    }
+    pc->fds[i] = -1;
+  }
+}
+
+#else
+
+static void perf_counters_open(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    pc->fds[i] = -1;
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  (void)pc;
+}
+
+#endif
+
+/* One line per measurement: what was measured, the wall time, and the
+   counters, with instructions per cycle when both are known. */
+static void perf_counters_report(FILE *out, const char *what, int64_t wall_usec,
+                                 const struct perf_counters *pc) {
+  fprintf(out, "%s: %lld us", what, (long long)wall_usec);
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->values[i] < 0) {
+      fprintf(out, ", %s n/a", perf_counter_names[i]);
+    } else {
+      fprintf(out, ", %s %lld", perf_counter_names[i], (long long)pc->values[i]);
+    }
+  }
+  if (pc->values[0] > 0 && pc->values[1] >= 0) {
+    fprintf(out, ", IPC %.2f", (double)pc->values[1] / pc->values[0]);
+  }
+  fputc('\n', out);
+}
+
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
@@ -556,51 +735,84 @@ static int write_str_bool(FILE *out, void *src) {
 // Reading little-endian byte sequences.  On big-endian hosts, we flip
 // the resulting bytes.
 
+static uint16_t bswap_2byte(uint16_t x) {
+  return (x>>8) | (x<<8);
+}
+
+static uint32_t bswap_4byte(uint32_t x) {
+  return
+    ((x>>24)&0xFF) |
+    ((x>>8) &0xFF00) |
+    ((x<<8) &0xFF0000) |
+    ((x<<24)&0xFF000000);
+}
+
+static uint64_t bswap_8byte(uint64_t x) {
+  return
+    ((x>>56)&0xFFull) |
+    ((x>>40)&0xFF00ull) |
+    ((x>>24)&0xFF0000ull) |
+    ((x>>8) &0xFF000000ull) |
+    ((x<<8) &0xFF00000000ull) |
+    ((x<<24)&0xFF0000000000ull) |
+    ((x<<40)&0xFF000000000000ull) |
+    ((x<<56)&0xFF00000000000000ull);
+}
+
+// Convert n little-endian elements in place to host byte order.  A
+// no-op on little-endian hosts.
+static void le_to_host(void* data, size_t elem_size, size_t n) {
+  if (!IS_BIG_ENDIAN) {
+    return;
+  }
+  switch (elem_size) {
+  case 2:
+    for (size_t i = 0; i < n; i++) {
+      ((uint16_t*)data)[i] = bswap_2byte(((uint16_t*)data)[i]);
+    }
+    break;
+  case 4:
+    for (size_t i = 0; i < n; i++) {
+      ((uint32_t*)data)[i] = bswap_4byte(((uint32_t*)data)[i]);
+    }
+    break;
+  case 8:
+    for (size_t i = 0; i < n; i++) {
+      ((uint64_t*)data)[i] = bswap_8byte(((uint64_t*)data)[i]);
+    }
+    break;
+  }
+}
+
+// Bytes and time spent in bulk binary reads, for --load-rate.
+static int64_t bin_bytes_read = 0;
+static int64_t bin_read_usec = 0;
+
+// Read n little-endian elements with a single fread, rather than one
+// libc call per element.  Returns the number of elements read.
+static size_t read_le_bulk(void* dest, size_t elem_size, size_t n) {
+  int64_t t_start = get_wall_time();
+  size_t num_elems_read = fread(dest, elem_size, n, stdin);
+  le_to_host(dest, elem_size, num_elems_read);
+  bin_read_usec += get_wall_time() - t_start;
+  bin_bytes_read += num_elems_read * elem_size;
+  return num_elems_read;
+}
+
 static int read_byte(void* dest) {
-  int num_elems_read = fread(dest, 1, 1, stdin);
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 1, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_2byte(void* dest) {
-  uint16_t x;
-  int num_elems_read = fread(&x, 2, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x = (x>>8) | (x<<8);
-  }
-  *(uint16_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 2, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_4byte(void* dest) {
-  uint32_t x;
-  int num_elems_read = fread(&x, 4, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>24)&0xFF) |
-      ((x>>8) &0xFF00) |
-      ((x<<8) &0xFF0000) |
-      ((x<<24)&0xFF000000);
-  }
-  *(uint32_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 4, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_8byte(void* dest) {
-  uint64_t x;
-  int num_elems_read = fread(&x, 8, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>56)&0xFFull) |
-      ((x>>40)&0xFF00ull) |
-      ((x>>24)&0xFF0000ull) |
-      ((x>>8) &0xFF000000ull) |
-      ((x<<8) &0xFF00000000ull) |
-      ((x<<24)&0xFF0000000000ull) |
-      ((x<<40)&0xFF000000000000ull) |
-      ((x<<56)&0xFF00000000000000ull);
-  }
-  *(uint64_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 8, 1) == 1 ? 0 : 1;
 }
 
 static int write_byte(void* dest) {
@@ -793,12 +1005,12 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
 
   uint64_t elem_count = 1;
+  size_t num_dims_read = read_le_bulk(shape, sizeof(int64_t), dims);
+  if (num_dims_read != (size_t)dims) {
+    panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", (int)num_dims_read);
+  }
   for (int i=0; i<dims; i++) {
-    uint64_t bin_shape;
-    ret = read_le_8byte(&bin_shape);
-    if (ret != 0) { panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", i); }
-    elem_count *= bin_shape;
-    shape[i] = (int64_t) bin_shape;
+    elem_count *= (uint64_t) shape[i];
   }
 
   size_t elem_size = expected_type->size;
@@ -809,27 +1021,12 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
   *data = tmp;
 
-  size_t num_elems_read = fread(*data, elem_size, elem_count, stdin);
+  size_t num_elems_read = read_le_bulk(*data, elem_size, elem_count);
   if (num_elems_read != elem_count) {
     panic(1, "binary-input: tried to read %i elements of an array, but only got %i elements.\n",
           elem_count, num_elems_read);
   }
 
-  // If we're on big endian platform we must change all multibyte elements
-  // from using little endian to big endian
-  if (IS_BIG_ENDIAN && elem_size != 1) {
-    char* elems = (char*) *data;
-    for (uint64_t i=0; i<elem_count; i++) {
-      char* elem = elems+(i*elem_size);
-      for (unsigned int j=0; j<elem_size/2; j++) {
-        char head = elem[j];
-        int tail_index = elem_size-1-j;
-        elem[j] = elem[tail_index];
-        elem[tail_index] = head;
-      }
-    }
-  }
-
   return 0;
 }
 
@@ -937,7 +1134,573 @@ static int write_scalar(FILE *out, int write_binary, const struct primtype_info_
   }
 }
 
+/* Server mode.  Instead of running one entry point on stdin, the
+   program keeps named values alive between commands read from stdin
+   or, with --socket, from clients of a Unix socket:
+
+     call ENTRY OUT... IN...        run ENTRY on the named inputs
+     restore FILE VAR TYPE ...      read values from FILE, e.g. "[]i32"
+     store FILE VAR ...             write values to FILE
+     free VAR ...
+     rename OLD NEW
+     inputs ENTRY / outputs ENTRY   list parameter and result types
+     clear                          free everything
+     report                         futhark_debugging_report
+     exit                           stop the server
+
+   Arrays are kept as values of the program's array types, so call
+   hands them to the entry point as they are and its results stay in
+   the context; only restore and store copy data in or out.  FILE is in
+   the binary data format, as store writes it.  Every command is
+   answered with "%%% OK" on a line of its own, after a "%%% FAILURE"
+   line and a message if it failed.  A file that cannot be read fails
+   its restore, keeping the values read before the bad one. */
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// An array type of the entry points, under its name in "inputs"
+struct server_array_type {
+  const char *name;
+  const struct primtype_info_t *elem;
+  int rank;
+  void *(*new_array)(struct futhark_context *, const void *data, const int64_t *shape);
+  int (*free_array)(struct futhark_context *, void *arr);
+  int (*values)(struct futhark_context *, void *arr, void *data);
+  int64_t *(*shape)(struct futhark_context *, void *arr);
+};
+
+struct server_value {
+  char *name;
+  const char *type_name;
+  const struct primtype_info_t *type;     // of the scalar, or of the elements
+  const struct server_array_type *array;  // NULL for a scalar
+  void *data;                             // the scalar, or the array value
+};
+
+typedef int server_call_fun(struct futhark_context *, struct server_value **outs,
+                            struct server_value **ins);
+
+struct server_entry {
+  const char *name;
+  int num_ins;
+  const char *const *in_types;
+  int num_outs;
+  const char *const *out_types;
+  server_call_fun *call;
+};
+
+static int server_mode = 0;
+static const char *server_socket = NULL;
+
+static const struct server_array_type *server_array_types = NULL;
+static int server_num_array_types = 0;
+static struct server_value **server_values = NULL;
+static int server_num_values = 0;
+
+static void *server_malloc(size_t n) {
+  void *p = malloc(n == 0 ? 1 : n);
+  if (p == NULL) {
+    panic(1, "Out of memory in server mode.\n");
+  }
+  return p;
+}
+
+static char *server_strdup(const char *s) {
+  size_t n = strlen(s) + 1;
+  return memcpy(server_malloc(n), s, n);
+}
+
+static struct server_value *server_lookup(const char *name) {
+  for (int i = 0; i < server_num_values; i++) {
+    if (strcmp(server_values[i]->name, name) == 0) {
+      return server_values[i];
+    }
+  }
+  return NULL;
+}
+
+static void server_value_free(struct futhark_context *ctx, struct server_value *v) {
+  if (v->array == NULL) {
+    free(v->data);
+  } else if (v->data != NULL) {
+    v->array->free_array(ctx, v->data);
+  }
+  free(v->name);
+  free(v);
+}
+
+static void server_insert(struct server_value *v) {
+  struct server_value **grown =
+    realloc(server_values, (server_num_values + 1) * sizeof(struct server_value*));
+  if (grown == NULL) {
+    panic(1, "Out of memory in server mode.\n");
+  }
+  server_values = grown;
+  server_values[server_num_values++] = v;
+}
+
+static int server_remove(struct futhark_context *ctx, const char *name) {
+  for (int i = 0; i < server_num_values; i++) {
+    if (strcmp(server_values[i]->name, name) == 0) {
+      server_value_free(ctx, server_values[i]);
+      server_values[i] = server_values[--server_num_values];
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// A scalar of any primitive type, or one of the program's array types;
+// NULL if type_name is neither.  Arrays start out empty.
+static struct server_value *server_new_value(const char *name, const char *type_name) {
+  const struct server_array_type *array = NULL;
+  const struct primtype_info_t *type = NULL;
+  for (int i = 0; i < server_num_array_types; i++) {
+    if (strcmp(server_array_types[i].name, type_name) == 0) {
+      array = &server_array_types[i];
+      type = array->elem;
+    }
+  }
+  for (int i = 0; type == NULL && primtypes[i] != NULL; i++) {
+    if (strcmp(primtypes[i]->type_name, type_name) == 0) {
+      type = primtypes[i];
+    }
+  }
+  if (type == NULL) {
+    return NULL;
+  }
+  struct server_value *v = server_malloc(sizeof(struct server_value));
+  v->name = server_strdup(name);
+  v->type_name = array != NULL ? array->name : type->type_name;
+  v->type = type;
+  v->array = array;
+  v->data = array != NULL ? NULL : memset(server_malloc(type->size), 0, type->size);
+  return v;
+}
+
+// Read v from f, in the binary data format.  Returns an error message,
+// or NULL on success.
+static const char *server_read_value(struct futhark_context *ctx, FILE *f,
+                                     struct server_value *v) {
+  int rank = v->array == NULL ? 0 : v->array->rank;
+  int c;
+  while ((c = getc(f)) != EOF && isspace(c)) {
+  }
+  int8_t version, dims;
+  char binname[4];
+  if (c != 'b' || fread(&version, 1, 1, f) != 1 || fread(&dims, 1, 1, f) != 1
+      || fread(binname, 1, 4, f) != 4) {
+    return "not a value in the binary data format";
+  }
+  if (version != BINARY_FORMAT_VERSION) {
+    return "unsupported binary data format version";
+  }
+  if (dims != rank || memcmp(binname, v->type->binname, 4) != 0) {
+    return "value of the wrong type";
+  }
+  int64_t shape[8];
+  int64_t count = 1;
+  if (fread(shape, sizeof(int64_t), rank, f) != (size_t) rank) {
+    return "truncated value";
+  }
+  le_to_host(shape, sizeof(int64_t), rank);
+  for (int i = 0; i < rank; i++) {
+    // The array constructors take int dimensions
+    if (shape[i] < 0 || shape[i] > INT32_MAX) {
+      return "invalid array shape";
+    }
+    if (shape[i] > 0 && count > INT64_MAX / v->type->size / shape[i]) {
+      return "invalid array shape";
+    }
+    count *= shape[i];
+  }
+  // Check against what is left of the file before allocating for it
+  struct stat st;
+  long pos = ftell(f);
+  if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && pos >= 0
+      && count * v->type->size > st.st_size - pos) {
+    return "truncated value";
+  }
+  void *buf = rank == 0 ? v->data : malloc(count == 0 ? 1 : count * v->type->size);
+  if (buf == NULL) {
+    return "value too large";
+  }
+  if (fread(buf, v->type->size, count, f) != (size_t) count) {
+    if (rank > 0) {
+      free(buf);
+    }
+    return "truncated value";
+  }
+  le_to_host(buf, v->type->size, count);
+  if (rank > 0) {
+    v->data = v->array->new_array(ctx, buf, shape);
+    free(buf);
+    if (v->data == NULL) {
+      return "cannot make array";
+    }
+  }
+  return NULL;
+}
+
+static int server_write_value(struct futhark_context *ctx, FILE *f, struct server_value *v) {
+  if (v->array == NULL) {
+    int64_t no_shape[1] = {0};
+    return write_bin_array(f, v->type, v->data, no_shape, 0);
+  }
+  int64_t *shape = v->array->shape(ctx, v->data);
+  int64_t count = 1;
+  for (int i = 0; i < v->array->rank; i++) {
+    count *= shape[i];
+  }
+  void *buf = malloc(count == 0 ? 1 : count * v->type->size);
+  if (buf == NULL || v->array->values(ctx, v->data, buf) != 0) {
+    free(buf);
+    return 1;
+  }
+  int ret = write_bin_array(f, v->type, buf, shape, v->array->rank);
+  free(buf);
+  return ret;
+}
+
+static const struct server_entry *server_find_entry(const struct server_entry *entries,
+                                                    int num_entries, const char *name) {
+  for (int i = 0; i < num_entries; i++) {
+    if (strcmp(entries[i].name, name) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+// Returns an error message, or NULL on success.
+static const char *server_command(struct futhark_context *ctx, FILE *out,
+                                  const struct server_entry *entries, int num_entries,
+                                  char **words, int n, char *err, size_t errsize) {
+  const char *cmd = words[0];
+
+  if (strcmp(cmd, "call") == 0) {
+    const struct server_entry *e = n > 1 ? server_find_entry(entries, num_entries, words[1]) : NULL;
+    if (e == NULL) {
+      return "unknown entry point";
+    }
+    if (n != 2 + e->num_outs + e->num_ins) {
+      snprintf(err, errsize, "%s takes %d outputs and %d inputs", e->name, e->num_outs, e->num_ins);
+      return err;
+    }
+    struct server_value *ins[e->num_ins + 1], *outs[e->num_outs + 1];
+    for (int i = 0; i < e->num_ins; i++) {
+      ins[i] = server_lookup(words[2 + e->num_outs + i]);
+      if (ins[i] == NULL) {
+        snprintf(err, errsize, "unknown variable %s", words[2 + e->num_outs + i]);
+        return err;
+      }
+      if (strcmp(ins[i]->type_name, e->in_types[i]) != 0) {
+        snprintf(err, errsize, "%s does not have type %s", ins[i]->name, e->in_types[i]);
+        return err;
+      }
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      if (server_lookup(words[2 + i]) != NULL) {
+        snprintf(err, errsize, "variable %s already exists", words[2 + i]);
+        return err;
+      }
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      outs[i] = server_new_value(words[2 + i], e->out_types[i]);
+    }
+    int64_t t_start = get_wall_time();
+    int r = e->call(ctx, outs, ins);
+    if (r == 0) {
+      r = futhark_context_sync(ctx);
+    }
+    int64_t t_end = get_wall_time();
+    if (r != 0) {
+      for (int i = 0; i < e->num_outs; i++) {
+        server_value_free(ctx, outs[i]);
+      }
+      char *msg = futhark_context_get_error(ctx);
+      snprintf(err, errsize, "%s", msg != NULL ? msg : "entry point failed");
+      free(msg);
+      // Messages end in a newline of their own; the session adds one
+      for (size_t len = strlen(err); len > 0 && err[len - 1] == '\n'; len--) {
+        err[len - 1] = 0;
+      }
+      return err;
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      server_insert(outs[i]);
+    }
+    fprintf(out, "runtime: %lld\n", (long long) (t_end - t_start));
+    return NULL;
+  }
+
+  if (strcmp(cmd, "restore") == 0) {
+    if (n < 2 || (n - 2) % 2 != 0) {
+      return "usage: restore FILE VAR TYPE ...";
+    }
+    FILE *f = fopen(words[1], "rb");
+    if (f == NULL) {
+      snprintf(err, errsize, "%s: %s", words[1], strerror(errno));
+      return err;
+    }
+    const char *msg = NULL;
+    for (int i = 2; i < n && msg == NULL; i += 2) {
+      if (server_lookup(words[i]) != NULL) {
+        snprintf(err, errsize, "variable %s already exists", words[i]);
+        msg = err;
+        break;
+      }
+      struct server_value *v = server_new_value(words[i], words[i + 1]);
+      if (v == NULL) {
+        snprintf(err, errsize, "unsupported type %s", words[i + 1]);
+        msg = err;
+        break;
+      }
+      const char *problem = server_read_value(ctx, f, v);
+      if (problem != NULL) {
+        server_value_free(ctx, v);
+        snprintf(err, errsize, "cannot read %s from %s: %s", words[i], words[1], problem);
+        msg = err;
+        break;
+      }
+      server_insert(v);
+    }
+    fclose(f);
+    return msg;
+  }
+
+  if (strcmp(cmd, "store") == 0) {
+    if (n < 2) {
+      return "usage: store FILE VAR ...";
+    }
+    for (int i = 2; i < n; i++) {
+      if (server_lookup(words[i]) == NULL) {
+        snprintf(err, errsize, "unknown variable %s", words[i]);
+        return err;
+      }
+    }
+    FILE *f = fopen(words[1], "wb");
+    if (f == NULL) {
+      snprintf(err, errsize, "%s: %s", words[1], strerror(errno));
+      return err;
+    }
+    int failed = 0;
+    for (int i = 2; i < n; i++) {
+      failed |= server_write_value(ctx, f, server_lookup(words[i]));
+    }
+    failed |= ferror(f);
+    if (fclose(f) != 0 || failed) {
+      snprintf(err, errsize, "%s: write failed", words[1]);
+      return err;
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "free") == 0) {
+    for (int i = 1; i < n; i++) {
+      if (server_remove(ctx, words[i]) != 0) {
+        snprintf(err, errsize, "unknown variable %s", words[i]);
+        return err;
+      }
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "rename") == 0) {
+    if (n != 3) {
+      return "usage: rename OLD NEW";
+    }
+    struct server_value *v = server_lookup(words[1]);
+    if (v == NULL) {
+      snprintf(err, errsize, "unknown variable %s", words[1]);
+      return err;
+    }
+    if (server_lookup(words[2]) != NULL) {
+      snprintf(err, errsize, "variable %s already exists", words[2]);
+      return err;
+    }
+    free(v->name);
+    v->name = server_strdup(words[2]);
+    return NULL;
+  }
+
+  if (strcmp(cmd, "inputs") == 0 || strcmp(cmd, "outputs") == 0) {
+    const struct server_entry *e = n == 2 ? server_find_entry(entries, num_entries, words[1]) : NULL;
+    if (e == NULL) {
+      return "unknown entry point";
+    }
+    int inputs = strcmp(cmd, "inputs") == 0;
+    for (int i = 0; i < (inputs ? e->num_ins : e->num_outs); i++) {
+      fprintf(out, "%s\n", inputs ? e->in_types[i] : e->out_types[i]);
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "clear") == 0) {
+    while (server_num_values > 0) {
+      server_value_free(ctx, server_values[--server_num_values]);
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "report") == 0) {
+    futhark_debugging_report(ctx);
+    return NULL;
+  }
+
+  snprintf(err, errsize, "unknown command %s", cmd);
+  return err;
+}
+
+// Serve one command stream; returns 1 if it asked the server to exit.
+static int server_session(struct futhark_context *ctx, FILE *in, FILE *out,
+                          const struct server_entry *entries, int num_entries) {
+  char line[4096], err[1024];
+  char *words[256];
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    int n = 0;
+    for (char *w = strtok(line, " \t\r\n"); w != NULL && n < 256; w = strtok(NULL, " \t\r\n")) {
+      words[n++] = w;
+    }
+    if (n == 0) {
+      continue;
+    }
+    if (strcmp(words[0], "exit") == 0) {
+      fprintf(out, "%%%%%% OK\n");
+      fflush(out);
+      return 1;
+    }
+    const char *msg = server_command(ctx, out, entries, num_entries, words, n, err, sizeof(err));
+    if (msg != NULL) {
+      fprintf(out, "%%%%%% FAILURE\n%s\n", msg);
+    }
+    fprintf(out, "%%%%%% OK\n");
+    // A client that went away ends its own session, not the server
+    if (fflush(out) != 0 || ferror(out)) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+// Make room for a socket at path.  Only a socket nobody is listening on
+// any more, left by a server that did not get to remove it, is deleted.
+static void server_claim_socket(const struct sockaddr_un *addr) {
+  struct stat st;
+  if (lstat(addr->sun_path, &st) != 0) {
+    return;
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    panic(1, "%s exists and is not a socket\n", addr->sun_path);
+  }
+  int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  int live = probe >= 0 && connect(probe, (const struct sockaddr*) addr, sizeof(*addr)) == 0;
+  if (probe >= 0) {
+    close(probe);
+  }
+  if (live) {
+    panic(1, "Another server is listening on %s\n", addr->sun_path);
+  }
+  unlink(addr->sun_path);
+}
+
+static void server_run(struct futhark_context *ctx,
+                       const struct server_array_type *array_types, int num_array_types,
+                       const struct server_entry *entries, int num_entries) {
+  server_array_types = array_types;
+  server_num_array_types = num_array_types;
+  if (server_socket == NULL) {
+    server_session(ctx, stdin, stdout, entries, num_entries);
+  } else {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(server_socket) >= sizeof(addr.sun_path)) {
+      panic(1, "Socket path too long: %s\n", server_socket);
+    }
+    strcpy(addr.sun_path, server_socket);
+    server_claim_socket(&addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+      panic(1, "Cannot listen on %s: %s\n", server_socket, strerror(errno));
+    }
+    // Writes to a disconnected client fail with EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+    // One client at a time; the values outlive the connections
+    int done = 0;
+    while (!done) {
+      int conn = accept(fd, NULL, NULL);
+      if (conn < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        panic(1, "Cannot accept on %s: %s\n", server_socket, strerror(errno));
+      }
+      FILE *in = fdopen(conn, "r");
+      FILE *out = fdopen(dup(conn), "w");
+      if (in == NULL || out == NULL) {
+        panic(1, "Cannot open connection: %s\n", strerror(errno));
+      }
+      done = server_session(ctx, in, out, entries, num_entries);
+      fclose(in);
+      fclose(out);
+    }
+    close(fd);
+    unlink(server_socket);
+  }
+  while (server_num_values > 0) {
+    server_value_free(ctx, server_values[--server_num_values]);
+  }
+  free(server_values);
+}
 static int binary_output = 0;
+static int report_load_rate = 0;
+static int perf_counting = 0;
+static const char *trace_file = NULL;
+static struct perf_counters perf_counters;
+/* Separate from the per-run counters, which every run restarts. */
+static struct perf_counters perf_counters_total;
+static int report_memory = 0;
+/* One line per entry point, with the worst call for each counter. */
+static void print_memory_report(struct futhark_context *ctx)
+{
+    const struct futhark_memory_record *rs;
+    int n = futhark_context_memory_records(ctx, &rs);
+    
+    for (int i = 0; i < n; i++) {
+        int first = 1, calls = 0;
+        struct futhark_memory_stats worst = {0, 0, 0, 0};
+        
+        for (int j = 0; j < n; j++) {
+            if (strcmp(rs[i].entry_point, rs[j].entry_point) != 0)
+                continue;
+            if (j < i) {
+                first = 0;
+                break;
+            }
+            calls++;
+            if (rs[j].stats.peak_bytes - rs[j].bytes_before >
+                worst.peak_bytes)
+                worst.peak_bytes = rs[j].stats.peak_bytes -
+                    rs[j].bytes_before;
+            if (rs[j].stats.allocations > worst.allocations)
+                worst.allocations = rs[j].stats.allocations;
+            if (rs[j].stats.largest_allocation > worst.largest_allocation)
+                worst.largest_allocation = rs[j].stats.largest_allocation;
+        }
+        if (first)
+            fprintf(stderr,
+                    "Entry point %s: %d calls, at most %lld bytes above the live set, %lld allocations, largest %lld bytes.\n",
+                    rs[i].entry_point, calls, (long long) worst.peak_bytes,
+                    (long long) worst.allocations,
+                    (long long) worst.largest_allocation);
+    }
+}
 static FILE *runtime_file;
 static int perform_warmup = 0;
 static int num_runs = 1;
@@ -954,6 +1717,15 @@ int parse_options(struct futhark_context_config *cfg, int argc,
                                            {"entry-point", required_argument,
                                             NULL, 5}, {"binary-output",
                                                        no_argument, NULL, 6},
+                                           {"load-rate", no_argument, NULL, 7},
+                                           {"server", no_argument, NULL, 8},
+                                           {"socket", required_argument, NULL,
+                                            9}, {"memory-report", no_argument,
+                                                 NULL, 10}, {"perf-counters",
+                                                             no_argument, NULL,
+                                                             11}, {"trace",
+                                                                   required_argument,
+                                                                   NULL, 12},
                                            {0, 0, 0, 0}};
     
     while ((ch = getopt_long(argc, argv, ":t:r:DLe:b", long_options, NULL)) !=
@@ -977,6 +1749,20 @@ int parse_options(struct futhark_context_config *cfg, int argc,
             entry_point = optarg;
         if (ch == 6 || ch == 'b')
             binary_output = 1;
+        if (ch == 7)
+            report_load_rate = 1;
+        if (ch == 8)
+            server_mode = 1;
+        if (ch == 9) {
+            server_mode = 1;
+            server_socket = optarg;
+        }
+        if (ch == 10)
+            report_memory = 1;
+        if (ch == 11)
+            perf_counting = 1;
+        if (ch == 12)
+            trace_file = optarg;
         if (ch == ':')
             panic(-1, "Missing argument for option %s\n", argv[optind - 1]);
         if (ch == '?')
@@ -984,6 +1770,366 @@ int parse_options(struct futhark_context_config *cfg, int argc,
     }
     return optind;
 }
+static void futrts_cli_entry_coo_get(struct futhark_context *ctx)
+{
+    int64_t t_start, t_end;
+    int time_runs;
+    int32_t read_value_1000;
+    
+    if (read_scalar(&i32_info, &read_value_1000) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 0,
+              "i32", strerror(errno));
+    
+    int32_t read_value_1001;
+    
+    if (read_scalar(&i32_info, &read_value_1001) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 1,
+              "i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1002;
+    int64_t read_shape_1003[1];
+    int32_t *read_arr_1004 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1004, read_shape_1003, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 2,
+              "[]i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1005;
+    int64_t read_shape_1006[1];
+    int32_t *read_arr_1007 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1007, read_shape_1006, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 3,
+              "[]i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1008;
+    int64_t read_shape_1009[1];
+    int32_t *read_arr_1010 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1010, read_shape_1009, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 4,
+              "[]i32", strerror(errno));
+    
+    int32_t read_value_1011;
+    
+    if (read_scalar(&i32_info, &read_value_1011) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 5,
+              "i32", strerror(errno));
+    
+    int32_t read_value_1012;
+    
+    if (read_scalar(&i32_info, &read_value_1012) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 6,
+              "i32", strerror(errno));
+    
+    int32_t result_1013;
+    
+    assert((read_value_1002 = futhark_new_i32_1d(ctx, read_arr_1004,
+                                                 read_shape_1003[0])) != 0);
+    assert((read_value_1005 = futhark_new_i32_1d(ctx, read_arr_1007,
+                                                 read_shape_1006[0])) != 0);
+    assert((read_value_1008 = futhark_new_i32_1d(ctx, read_arr_1010,
+                                                 read_shape_1009[0])) != 0);
+    if (perform_warmup) {
+        time_runs = 0;
+        
+        int r;
+        
+        assert(futhark_context_sync(ctx) == 0);
+        t_start = get_wall_time();
+        r = futhark_entry_coo_get(ctx, &result_1013, read_value_1000,
+                                  read_value_1001, read_value_1002,
+                                  read_value_1005, read_value_1008,
+                                  read_value_1011, read_value_1012);
+        if (r != 0)
+            panic(1, "%s", futhark_context_get_error(ctx));
+        assert(futhark_context_sync(ctx) == 0);
+        t_end = get_wall_time();
+        
+        long elapsed_usec = t_end - t_start;
+        
+        if (time_runs && runtime_file != NULL)
+            fprintf(runtime_file, "%lld\n", (long long) elapsed_usec);
+        ;
+    }
+    time_runs = 1;
+    /* Proper run. */
+    for (int run = 0; run < num_runs; run++) {
+        int r;
+        
+        assert(futhark_context_sync(ctx) == 0);
+        if (perf_counting)
+            perf_counters_start(&perf_counters);
+        t_start = get_wall_time();
+        r = futhark_entry_coo_get(ctx, &result_1013, read_value_1000,
+                                  read_value_1001, read_value_1002,
+                                  read_value_1005, read_value_1008,
+                                  read_value_1011, read_value_1012);
+        if (r != 0)
+            panic(1, "%s", futhark_context_get_error(ctx));
+        assert(futhark_context_sync(ctx) == 0);
+        t_end = get_wall_time();
+        
+        long elapsed_usec = t_end - t_start;
+        
+        if (perf_counting) {
+            perf_counters_stop(&perf_counters);
+            
+            char what[64];
+            
+            snprintf(what, sizeof(what), "Entry point coo_get, run %d", run);
+            perf_counters_report(stderr, what, elapsed_usec, &perf_counters);
+        }
+        if (time_runs && runtime_file != NULL)
+            fprintf(runtime_file, "%lld\n", (long long) elapsed_usec);
+        if (run < num_runs - 1) {
+            ;
+        }
+    }
+    assert(futhark_free_i32_1d(ctx, read_value_1002) == 0);
+    free(read_arr_1004);
+    assert(futhark_free_i32_1d(ctx, read_value_1005) == 0);
+    free(read_arr_1007);
+    assert(futhark_free_i32_1d(ctx, read_value_1008) == 0);
+    free(read_arr_1010);
+    write_scalar(stdout, binary_output, &i32_info, &result_1013);
+    printf("\n");
+    ;
+}
+static void futrts_cli_entry_coo_transpose(struct futhark_context *ctx)
+{
+    int64_t t_start, t_end;
+    int time_runs;
+    int32_t read_value_1020;
+    
+    if (read_scalar(&i32_info, &read_value_1020) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 0,
+              "i32", strerror(errno));
+    
+    int32_t read_value_1021;
+    
+    if (read_scalar(&i32_info, &read_value_1021) != 0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 1,
+              "i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1022;
+    int64_t read_shape_1023[1];
+    int32_t *read_arr_1024 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1024, read_shape_1023, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 2,
+              "[]i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1025;
+    int64_t read_shape_1026[1];
+    int32_t *read_arr_1027 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1027, read_shape_1026, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 3,
+              "[]i32", strerror(errno));
+    
+    struct futhark_i32_1d *read_value_1028;
+    int64_t read_shape_1029[1];
+    int32_t *read_arr_1030 = NULL;
+    
+    errno = 0;
+    if (read_array(&i32_info, (void **) &read_arr_1030, read_shape_1029, 1) !=
+        0)
+        panic(1, "Error when reading input #%d of type %s (errno: %s).\n", 4,
+              "[]i32", strerror(errno));
+    
+    int32_t result_1031;
+    int32_t result_1032;
+    struct futhark_i32_1d *result_1033;
+    struct futhark_i32_1d *result_1034;
+    struct futhark_i32_1d *result_1035;
+    
+    assert((read_value_1022 = futhark_new_i32_1d(ctx, read_arr_1024,
+                                                 read_shape_1023[0])) != 0);
+    assert((read_value_1025 = futhark_new_i32_1d(ctx, read_arr_1027,
+                                                 read_shape_1026[0])) != 0);
+    assert((read_value_1028 = futhark_new_i32_1d(ctx, read_arr_1030,
+                                                 read_shape_1029[0])) != 0);
+    if (perform_warmup) {
+        time_runs = 0;
+        
+        int r;
+        
+        assert(futhark_context_sync(ctx) == 0);
+        t_start = get_wall_time();
+        r = futhark_entry_coo_transpose(ctx, &result_1031, &result_1032,
+                                        &result_1033, &result_1034,
+                                        &result_1035, read_value_1020,
+                                        read_value_1021, read_value_1022,
+                                        read_value_1025, read_value_1028);
+        if (r != 0)
+            panic(1, "%s", futhark_context_get_error(ctx));
+        assert(futhark_context_sync(ctx) == 0);
+        t_end = get_wall_time();
+        
+        long elapsed_usec = t_end - t_start;
+        
+        if (time_runs && runtime_file != NULL)
+            fprintf(runtime_file, "%lld\n", (long long) elapsed_usec);
+        assert(futhark_free_i32_1d(ctx, result_1033) == 0);
+        assert(futhark_free_i32_1d(ctx, result_1034) == 0);
+        assert(futhark_free_i32_1d(ctx, result_1035) == 0);
+    }
+    time_runs = 1;
+    /* Proper run. */
+    for (int run = 0; run < num_runs; run++) {
+        int r;
+        
+        assert(futhark_context_sync(ctx) == 0);
+        if (perf_counting)
+            perf_counters_start(&perf_counters);
+        t_start = get_wall_time();
+        r = futhark_entry_coo_transpose(ctx, &result_1031, &result_1032,
+                                        &result_1033, &result_1034,
+                                        &result_1035, read_value_1020,
+                                        read_value_1021, read_value_1022,
+                                        read_value_1025, read_value_1028);
+        if (r != 0)
+            panic(1, "%s", futhark_context_get_error(ctx));
+        assert(futhark_context_sync(ctx) == 0);
+        t_end = get_wall_time();
+        
+        long elapsed_usec = t_end - t_start;
+        
+        if (perf_counting) {
+            perf_counters_stop(&perf_counters);
+            
+            char what[64];
+            
+            snprintf(what, sizeof(what), "Entry point coo_transpose, run %d",
+                     run);
+            perf_counters_report(stderr, what, elapsed_usec, &perf_counters);
+        }
+        if (time_runs && runtime_file != NULL)
+            fprintf(runtime_file, "%lld\n", (long long) elapsed_usec);
+        if (run < num_runs - 1) {
+            assert(futhark_free_i32_1d(ctx, result_1033) == 0);
+            assert(futhark_free_i32_1d(ctx, result_1034) == 0);
+            assert(futhark_free_i32_1d(ctx, result_1035) == 0);
+        }
+    }
+    assert(futhark_free_i32_1d(ctx, read_value_1022) == 0);
+    free(read_arr_1024);
+    assert(futhark_free_i32_1d(ctx, read_value_1025) == 0);
+    free(read_arr_1027);
+    assert(futhark_free_i32_1d(ctx, read_value_1028) == 0);
+    free(read_arr_1030);
+    write_scalar(stdout, binary_output, &i32_info, &result_1031);
+    printf("\n");
+    write_scalar(stdout, binary_output, &i32_info, &result_1032);
+    printf("\n");
+    {
+        int32_t *arr = calloc(sizeof(int32_t), futhark_shape_i32_1d(ctx,
+                                                                    result_1033)[0]);
+        
+        assert(arr != NULL);
+        assert(futhark_values_i32_1d(ctx, result_1033, arr) == 0);
+        write_array(stdout, binary_output, &i32_info, arr,
+                    futhark_shape_i32_1d(ctx, result_1033), 1);
+        free(arr);
+    }
+    printf("\n");
+    {
+        int32_t *arr = calloc(sizeof(int32_t), futhark_shape_i32_1d(ctx,
+                                                                    result_1034)[0]);
+        
+        assert(arr != NULL);
+        assert(futhark_values_i32_1d(ctx, result_1034, arr) == 0);
+        write_array(stdout, binary_output, &i32_info, arr,
+                    futhark_shape_i32_1d(ctx, result_1034), 1);
+        free(arr);
+    }
+    printf("\n");
+    {
+        int32_t *arr = calloc(sizeof(int32_t), futhark_shape_i32_1d(ctx,
+                                                                    result_1035)[0]);
+        
+        assert(arr != NULL);
+        assert(futhark_values_i32_1d(ctx, result_1035, arr) == 0);
+        write_array(stdout, binary_output, &i32_info, arr,
+                    futhark_shape_i32_1d(ctx, result_1035), 1);
+        free(arr);
+    }
+    printf("\n");
+    assert(futhark_free_i32_1d(ctx, result_1033) == 0);
+    assert(futhark_free_i32_1d(ctx, result_1034) == 0);
+    assert(futhark_free_i32_1d(ctx, result_1035) == 0);
+}
+static void *futrts_server_new_i32_1d(struct futhark_context *ctx,
+                                      const void *data, const int64_t *shape)
+{
+    return futhark_new_i32_1d(ctx, (int32_t *) data, shape[0]);
+}
+static int futrts_server_free_i32_1d(struct futhark_context *ctx, void *arr)
+{
+    return futhark_free_i32_1d(ctx, arr);
+}
+static int futrts_server_values_i32_1d(struct futhark_context *ctx, void *arr,
+                                       void *data)
+{
+    return futhark_values_i32_1d(ctx, arr, data);
+}
+static int64_t *futrts_server_shape_i32_1d(struct futhark_context *ctx,
+                                           void *arr)
+{
+    return futhark_shape_i32_1d(ctx, arr);
+}
+static const char *const futrts_server_ins_coo_get[] = {"i32", "i32", "[]i32",
+                                                        "[]i32", "[]i32", "i32",
+                                                        "i32"};
+static const char *const futrts_server_outs_coo_get[] = {"i32"};
+static int futrts_server_entry_coo_get(struct futhark_context *ctx,
+                                       struct server_value **outs,
+                                       struct server_value **ins)
+{
+    return futhark_entry_coo_get(ctx, (int32_t *) outs[0]->data,
+                                 *(int32_t *) ins[0]->data,
+                                 *(int32_t *) ins[1]->data, ins[2]->data,
+                                 ins[3]->data, ins[4]->data,
+                                 *(int32_t *) ins[5]->data,
+                                 *(int32_t *) ins[6]->data);
+}
+static const char *const futrts_server_ins_coo_transpose[] = {"i32", "i32",
+                                                              "[]i32", "[]i32",
+                                                              "[]i32"};
+static const char *const futrts_server_outs_coo_transpose[] = {"i32", "i32",
+                                                               "[]i32", "[]i32",
+                                                               "[]i32"};
+static int futrts_server_entry_coo_transpose(struct futhark_context *ctx,
+                                             struct server_value **outs,
+                                             struct server_value **ins)
+{
+    struct futhark_i32_1d *out2, *out3, *out4;
+    int ret = futhark_entry_coo_transpose(ctx, (int32_t *) outs[0]->data,
+                                          (int32_t *) outs[1]->data, &out2,
+                                          &out3, &out4,
+                                          *(int32_t *) ins[0]->data,
+                                          *(int32_t *) ins[1]->data,
+                                          ins[2]->data, ins[3]->data,
+                                          ins[4]->data);
+    
+    if (ret == 0) {
+        outs[2]->data = out2;
+        outs[3]->data = out3;
+        outs[4]->data = out4;
+    }
+    return ret;
+}
 typedef void entry_point_fun(struct futhark_context *);
 struct entry_point_entry {
     const char *name;
@@ -993,7 +2139,34 @@ int main(int argc, char **argv)
 {
     fut_progname = argv[0];
     
-    struct entry_point_entry entry_points[] = {};
+    struct entry_point_entry entry_points[] = {{.name ="coo_get", .fun =
+                                                futrts_cli_entry_coo_get},
+                                               {.name ="coo_transpose", .fun =
+                                                futrts_cli_entry_coo_transpose}};
+    struct server_array_type server_array_types[] = {{.name ="[]i32", .elem =
+                                                      &i32_info, .rank =1,
+                                                      .new_array =
+                                                      futrts_server_new_i32_1d,
+                                                      .free_array =
+                                                      futrts_server_free_i32_1d,
+                                                      .values =
+                                                      futrts_server_values_i32_1d,
+                                                      .shape =
+                                                      futrts_server_shape_i32_1d}};
+    struct server_entry server_entries[] = {{.name ="coo_get", .num_ins =7,
+                                             .in_types =
+                                             futrts_server_ins_coo_get,
+                                             .num_outs =1, .out_types =
+                                             futrts_server_outs_coo_get,
+                                             .call =
+                                             futrts_server_entry_coo_get},
+                                            {.name ="coo_transpose", .num_ins =
+                                             5, .in_types =
+                                             futrts_server_ins_coo_transpose,
+                                             .num_outs =5, .out_types =
+                                             futrts_server_outs_coo_transpose,
+                                             .call =
+                                             futrts_server_entry_coo_transpose}};
     struct futhark_context_config *cfg = futhark_context_config_new();
     
     assert(cfg != NULL);
@@ -1008,6 +2181,23 @@ int main(int argc, char **argv)
     struct futhark_context *ctx = futhark_context_new(cfg);
     
     assert(ctx != NULL);
+    if (report_memory)
+        futhark_context_set_memory_recording(ctx, 1);
+    if (trace_file != NULL)
+        futhark_context_set_tracing(ctx, 1);
+    if (perf_counting) {
+        perf_counters_open(&perf_counters);
+        perf_counters_open(&perf_counters_total);
+    }
+    
+    if (server_mode) {
+        server_run(ctx, server_array_types, sizeof(server_array_types) /
+                   sizeof(server_array_types[0]), server_entries,
+                   sizeof(server_entries) / sizeof(server_entries[0]));
+        futhark_context_free(ctx);
+        futhark_context_config_free(cfg);
+        return 0;
+    }
     
     int num_entry_points = sizeof(entry_points) / sizeof(entry_points[0]);
     entry_point_fun *entry_point_fun = NULL;
@@ -1026,9 +2216,37 @@ int main(int argc, char **argv)
             fprintf(stderr, "%s\n", entry_points[i].name);
         return 1;
     }
+    
+    int64_t entry_start = get_wall_time();
+    
+    if (perf_counting)
+        perf_counters_start(&perf_counters_total);
     entry_point_fun(ctx);
+    if (perf_counting) {
+        perf_counters_stop(&perf_counters_total);
+        
+        char what[256];
+        
+        snprintf(what, sizeof(what), "Entry point %s, all runs and I/O",
+                 entry_point);
+        perf_counters_report(stderr, what, get_wall_time() - entry_start,
+                             &perf_counters_total);
+        perf_counters_close(&perf_counters_total);
+        perf_counters_close(&perf_counters);
+    }
     if (runtime_file != NULL)
         fclose(runtime_file);
+    if (trace_file != NULL && futhark_context_write_trace(ctx, trace_file) != 0)
+        panic(1, "Cannot write trace to %s: %s\n", trace_file,
+              strerror(errno));
+    if (report_load_rate)
+        fprintf(stderr,
+                "Read %lld bytes of binary input in %lld us (%.2f MB/s).\n",
+                (long long) bin_bytes_read, (long long) bin_read_usec,
+                bin_read_usec == 0 ? 0.0 : (double) bin_bytes_read /
+                bin_read_usec);
+    if (report_memory)
+        print_memory_report(ctx);
     futhark_debugging_report(ctx);
     futhark_context_free(ctx);
     futhark_context_config_free(cfg);
@@ -1106,6 +2324,22 @@ struct memblock {
     int64_t size;
     const char *desc;
 } ;
+/* Size-class pool behind memblock_alloc.  Class 0 holds blocks of up to
+   16 bytes, and after that every power of two is split into four
+   classes, so at most a fifth of a block is slack.  Freed blocks go on
+   the free list of their class instead of back to malloc, and are handed
+   out again by the next allocation of that class.  The reference count
+   and the free list link live in a header in front of the block, so in
+   the steady state of a loop nothing is allocated at all. */
+#define MEMBLOCK_POOL_CLASSES 256
+#define MEMBLOCK_HEADER 16
+struct memblock_pool {
+    char *free[MEMBLOCK_POOL_CLASSES];
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
 struct futhark_context_config {
     int debugging;
 } ;
@@ -1135,6 +2369,14 @@ void futhark_context_config_set_logging(struct futhark_context_config *cfg,
     cfg = cfg;
     detail = detail;
 }
+struct trace_event {
+    const char *cat;
+    const char *name;
+    int64_t start;
+    int64_t end;
+    int64_t allocated;
+    int64_t live;
+} ;
 struct futhark_context {
     int detail_memory;
     int debugging;
@@ -1142,6 +2384,16 @@ struct futhark_context {
     char *error;
     int64_t peak_mem_usage_default;
     int64_t cur_mem_usage_default;
+    struct memblock_pool pool;
+    int64_t num_allocs_default;
+    int64_t largest_alloc_default;
+    int record_memory;
+    struct futhark_memory_record *memory_records;
+    int num_memory_records;
+    int64_t alloc_bytes_default;
+    int tracing;
+    struct trace_event *trace_events;
+    int num_trace_events;
 } ;
 struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
 {
@@ -1155,10 +2407,24 @@ struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
     create_lock(&ctx->lock);
     ctx->peak_mem_usage_default = 0;
     ctx->cur_mem_usage_default = 0;
+    memset(&ctx->pool, 0, sizeof(ctx->pool));
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    ctx->record_memory = 0;
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    ctx->alloc_bytes_default = 0;
+    ctx->tracing = 0;
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
     return ctx;
 }
+static void memblock_pool_trim(struct futhark_context *ctx);
 void futhark_context_free(struct futhark_context *ctx)
 {
+    memblock_pool_trim(ctx);
+    free(ctx->memory_records);
+    free(ctx->trace_events);
     free_lock(&ctx->lock);
     free(ctx);
 }
@@ -1174,6 +2440,89 @@ char *futhark_context_get_error(struct futhark_context *ctx)
     ctx->error = NULL;
     return error;
 }
+static int memblock_class(int64_t size)
+{
+    if (size <= 16)
+        return 0;
+    
+    int k = 4;
+    
+    while (((int64_t) 1 << (k + 1)) < size)
+        k++;
+    
+    int64_t step = (int64_t) 1 << (k - 2);
+    int64_t q = (size + step - 1) / step;
+    
+    return 4 * (k - 4) + (int) (q - 4);
+}
+static int64_t memblock_class_size(int c)
+{
+    if (c == 0)
+        return 16;
+    return (int64_t) (5 + (c - 1) % 4) << (4 + (c - 1) / 4 - 2);
+}
+static char **memblock_pool_link(char *raw)
+{
+    return (char **) (raw + sizeof(int64_t));
+}
+static char *memblock_pool_get(struct futhark_context *ctx, int64_t size)
+{
+    int c = memblock_class(size);
+    char *raw = ctx->pool.free[c];
+    
+    if (raw != NULL) {
+        ctx->pool.free[c] = *memblock_pool_link(raw);
+        ctx->pool.hits++;
+        ctx->pool.bytes_retained -= memblock_class_size(c);
+        ctx->pool.blocks_retained--;
+    } else {
+        raw = malloc(MEMBLOCK_HEADER + memblock_class_size(c));
+        if (raw == NULL)
+            panic(1, "Failed to allocate %lld bytes in %s.\n", (long long) size,
+                  "default space");
+        ctx->pool.misses++;
+    }
+    return raw;
+}
+static void memblock_pool_put(struct futhark_context *ctx, char *raw,
+                              int64_t size)
+{
+    int c = memblock_class(size);
+    
+    *memblock_pool_link(raw) = ctx->pool.free[c];
+    ctx->pool.free[c] = raw;
+    ctx->pool.bytes_retained += memblock_class_size(c);
+    ctx->pool.blocks_retained++;
+}
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    stats->hits = ctx->pool.hits;
+    stats->misses = ctx->pool.misses;
+    stats->bytes_retained = ctx->pool.bytes_retained;
+    stats->blocks_retained = ctx->pool.blocks_retained;
+    lock_unlock(&ctx->lock);
+}
+static void memblock_pool_trim(struct futhark_context *ctx)
+{
+    for (int c = 0; c < MEMBLOCK_POOL_CLASSES; c++) {
+        while (ctx->pool.free[c] != NULL) {
+            char *raw = ctx->pool.free[c];
+            
+            ctx->pool.free[c] = *memblock_pool_link(raw);
+            free(raw);
+        }
+    }
+    ctx->pool.bytes_retained = 0;
+    ctx->pool.blocks_retained = 0;
+}
+void futhark_context_pool_trim(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    memblock_pool_trim(ctx);
+    lock_unlock(&ctx->lock);
+}
 static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                           const char *desc)
 {
@@ -1185,8 +2534,7 @@ static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                     desc, block->desc, "default space", *block->references);
         if (*block->references == 0) {
             ctx->cur_mem_usage_default -= block->size;
-            free(block->mem);
-            free(block->references);
+            memblock_pool_put(ctx, (char *) block->references, block->size);
             if (ctx->detail_memory)
                 fprintf(stderr,
                         "%lld bytes freed (now allocated: %lld bytes)\n",
@@ -1207,12 +2555,18 @@ static int memblock_alloc(struct futhark_context *ctx, struct memblock *block,
     
     int ret = memblock_unref(ctx, block, desc);
     
-    block->mem = (char *) malloc(size);
-    block->references = (int *) malloc(sizeof(int));
+    char *raw = memblock_pool_get(ctx, size);
+    
+    block->references = (int *) raw;
+    block->mem = raw + MEMBLOCK_HEADER;
     *block->references = 1;
     block->size = size;
     block->desc = desc;
     ctx->cur_mem_usage_default += size;
+    ctx->num_allocs_default++;
+    ctx->alloc_bytes_default += size;
+    if (size > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = size;
     if (ctx->detail_memory)
         fprintf(stderr,
                 "Allocated %lld bytes for %s in %s (now allocated: %lld bytes)",
@@ -1235,14 +2589,247 @@ static int memblock_set(struct futhark_context *ctx, struct memblock *lhs,
     *lhs = *rhs;
     return ret;
 }
+/* Memory counters.  Peak, allocation count and largest allocation run
+   from context creation or the last futhark_context_memory_reset.  With
+   recording on, every entry point call also gets a record of its own:
+   the counters are zeroed when the call starts, copied into the record
+   when it returns, and then folded back into the running totals. */
+static void memory_stats_get(struct futhark_context *ctx,
+                             struct futhark_memory_stats *stats)
+{
+    stats->peak_bytes = ctx->peak_mem_usage_default;
+    stats->current_bytes = ctx->cur_mem_usage_default;
+    stats->allocations = ctx->num_allocs_default;
+    stats->largest_allocation = ctx->largest_alloc_default;
+}
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    memory_stats_get(ctx, stats);
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_memory_reset(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->record_memory = flag;
+    lock_unlock(&ctx->lock);
+}
+/* The records point into the context's own array, which the next
+   recorded entry point call may move, and which
+   futhark_context_clear_memory_records frees.  Copy them out before
+   calling into the context again. */
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records)
+{
+    lock_lock(&ctx->lock);
+    
+    int n = ctx->num_memory_records;
+    
+    *records = ctx->memory_records;
+    lock_unlock(&ctx->lock);
+    return n;
+}
+void futhark_context_clear_memory_records(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->memory_records);
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    lock_unlock(&ctx->lock);
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void memory_record_begin(struct futhark_context *ctx,
+                                struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    memory_stats_get(ctx, saved);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void memory_record_end(struct futhark_context *ctx, const char *entry,
+                              const struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    
+    int n = ctx->num_memory_records;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct futhark_memory_record *grown =
+                                     realloc(ctx->memory_records, (n == 0 ? 1 :
+                                                                   2 * n) *
+                                             sizeof(struct futhark_memory_record));
+        
+        if (grown == NULL)
+            panic(1, "Failed to record memory use of %s.\n", entry);
+        ctx->memory_records = grown;
+    }
+    
+    struct futhark_memory_record *r = &ctx->memory_records[n];
+    
+    r->entry_point = entry;
+    r->bytes_before = saved->current_bytes;
+    memory_stats_get(ctx, &r->stats);
+    ctx->num_memory_records = n + 1;
+    if (saved->peak_bytes > ctx->peak_mem_usage_default)
+        ctx->peak_mem_usage_default = saved->peak_bytes;
+    ctx->num_allocs_default += saved->allocations;
+    if (saved->largest_allocation > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = saved->largest_allocation;
+}
+/* Tracing.  With tracing on, every entry point call is recorded with its
+   wall time, the bytes allocated while it ran and the bytes live when it
+   finished, and futhark_context_write_trace writes them as Chrome
+   trace-event JSON.  Only the entry point boundary is traced: phases
+   inside a body have no source names here and would be lost when the
+   program is regenerated, so make an operation its own entry point to
+   see it on the timeline. */
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->tracing = flag;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_clear_trace(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->trace_events);
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
+    lock_unlock(&ctx->lock);
+}
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path)
+{
+    FILE *out = fopen(path, "w");
+    
+    if (out == NULL)
+        return 1;
+    lock_lock(&ctx->lock);
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    
+    int first = 1;
+    
+    for (int i = 0; i < ctx->num_trace_events; i++) {
+        struct trace_event *e = &ctx->trace_events[i];
+        
+        if (e->end < 0)
+            continue;
+        fprintf(out,
+                "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %lld, \"dur\": %lld, \"args\": {\"allocated_bytes\": %lld, \"live_bytes\": %lld}},\n{\"name\": \"memory\", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, \"args\": {\"live_bytes\": %lld}}",
+                first ? "" : ",", e->name, e->cat, (long long) e->start,
+                (long long) (e->end - e->start), (long long) e->allocated,
+                (long long) e->live, (long long) e->end, (long long) e->live);
+        first = 0;
+    }
+    fprintf(out, "\n]}\n");
+    lock_unlock(&ctx->lock);
+    return fclose(out) != 0;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static int trace_begin(struct futhark_context *ctx, const char *cat,
+                       const char *name)
+{
+    if (!ctx->tracing)
+        return -1;
+    
+    int n = ctx->num_trace_events;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct trace_event *grown = realloc(ctx->trace_events, (n == 0 ? 1 :
+                                                                2 * n) *
+                                            sizeof(struct trace_event));
+        
+        if (grown == NULL)
+            panic(1, "Failed to trace %s.\n", name);
+        ctx->trace_events = grown;
+    }
+    
+    struct trace_event *e = &ctx->trace_events[n];
+    
+    e->cat = cat;
+    e->name = name;
+    e->end = -1;
+    e->allocated = ctx->alloc_bytes_default;
+    e->start = get_wall_time();
+    ctx->num_trace_events = n + 1;
+    return n;
+}
+#ifdef __GNUC__
+__attribute__((unused))
+#endif
+static void trace_end(struct futhark_context *ctx, int event)
+{
+    if (event < 0)
+        return;
+    
+    struct trace_event *e = &ctx->trace_events[event];
+    
+    e->end = get_wall_time();
+    e->allocated = ctx->alloc_bytes_default - e->allocated;
+    e->live = ctx->cur_mem_usage_default;
+}
 void futhark_debugging_report(struct futhark_context *ctx)
 {
     if (ctx->detail_memory) {
         fprintf(stderr, "Peak memory usage for default space: %lld bytes.\n",
                 (long long) ctx->peak_mem_usage_default);
+        fprintf(stderr,
+                "%lld allocations, the largest %lld bytes.\n",
+                (long long) ctx->num_allocs_default,
+                (long long) ctx->largest_alloc_default);
+        fprintf(stderr,
+                "Memory pool: %lld hits, %lld misses, %lld bytes retained in %lld blocks.\n",
+                (long long) ctx->pool.hits, (long long) ctx->pool.misses,
+                (long long) ctx->pool.bytes_retained,
+                (long long) ctx->pool.blocks_retained);
     }
     if (ctx->debugging) { }
 }
+static int futrts_coo_get(struct futhark_context *ctx,
+                          int32_t *out_scalar_out_1100,
+                          struct memblock rows_mem_1101,
+                          struct memblock cols_mem_1102,
+                          struct memblock vals_mem_1103, int32_t sizze_1104,
+                          int32_t n_1105, int32_t m_1106, int32_t i_1107,
+                          int32_t j_1108);
+static int futrts_coo_transpose(struct futhark_context *ctx,
+                                int32_t *out_scalar_out_1120,
+                                int32_t *out_scalar_out_1121,
+                                int64_t *out_out_memsizze_1122,
+                                struct memblock *out_mem_p_1123,
+                                int32_t *out_out_arrsizze_1124,
+                                int64_t *out_out_memsizze_1125,
+                                struct memblock *out_mem_p_1126,
+                                int32_t *out_out_arrsizze_1127,
+                                int64_t *out_out_memsizze_1128,
+                                struct memblock *out_mem_p_1129,
+                                int32_t *out_out_arrsizze_1130,
+                                struct memblock rows_mem_1131,
+                                struct memblock cols_mem_1132,
+                                struct memblock vals_mem_1133,
+                                int32_t sizze_1134, int32_t n_1135,
+                                int32_t m_1136);
 static inline int8_t add8(int8_t x, int8_t y)
 {
     return x + y;
@@ -2215,3 +3802,317 @@ static inline double futrts_from_bits64(int64_t x)
     p.f = x;
     return p.t;
 }
+static int futrts_coo_get(struct futhark_context *ctx,
+                          int32_t *out_scalar_out_1100,
+                          struct memblock rows_mem_1101,
+                          struct memblock cols_mem_1102,
+                          struct memblock vals_mem_1103, int32_t sizze_1104,
+                          int32_t n_1105, int32_t m_1106, int32_t i_1107,
+                          int32_t j_1108)
+{
+    int32_t scalar_out_1109;
+    int32_t res_1110;
+    int32_t redout_1111 = sizze_1104;
+    
+    for (int32_t i_1112 = 0; i_1112 < sizze_1104; i_1112++) {
+        int32_t x_1113 = *(int32_t *) &rows_mem_1101.mem[i_1112 * 4];
+        int32_t x_1114 = *(int32_t *) &cols_mem_1102.mem[i_1112 * 4];
+        bool cond_1115 = x_1113 == i_1107;
+        bool cond_1116 = x_1114 == j_1108;
+        bool cond_1117 = cond_1115 && cond_1116;
+        int32_t res_1118;
+        
+        if (cond_1117) {
+            res_1118 = i_1112;
+        } else {
+            res_1118 = sizze_1104;
+        }
+        
+        int32_t res_1119 = smin32(redout_1111, res_1118);
+        
+        redout_1111 = res_1119;
+    }
+    res_1110 = redout_1111;
+    
+    bool cond_1140 = res_1110 == sizze_1104;
+    int32_t res_1141;
+    
+    if (cond_1140) {
+        res_1141 = 0;
+    } else {
+        int32_t res_1142 = *(int32_t *) &vals_mem_1103.mem[res_1110 * 4];
+        
+        res_1141 = res_1142;
+    }
+    scalar_out_1109 = res_1141;
+    *out_scalar_out_1100 = scalar_out_1109;
+    return 0;
+}
+static int futrts_coo_transpose(struct futhark_context *ctx,
+                                int32_t *out_scalar_out_1120,
+                                int32_t *out_scalar_out_1121,
+                                int64_t *out_out_memsizze_1122,
+                                struct memblock *out_mem_p_1123,
+                                int32_t *out_out_arrsizze_1124,
+                                int64_t *out_out_memsizze_1125,
+                                struct memblock *out_mem_p_1126,
+                                int32_t *out_out_arrsizze_1127,
+                                int64_t *out_out_memsizze_1128,
+                                struct memblock *out_mem_p_1129,
+                                int32_t *out_out_arrsizze_1130,
+                                struct memblock rows_mem_1131,
+                                struct memblock cols_mem_1132,
+                                struct memblock vals_mem_1133,
+                                int32_t sizze_1134, int32_t n_1135,
+                                int32_t m_1136)
+{
+    int64_t binop_x_1143 = sext_i32_i64(sizze_1134);
+    int64_t bytes_1144 = 4 * binop_x_1143;
+    
+    *out_scalar_out_1120 = m_1136;
+    *out_scalar_out_1121 = n_1135;
+    *out_out_memsizze_1122 = bytes_1144;
+    (*out_mem_p_1123).references = NULL;
+    if (memblock_set(ctx, &*out_mem_p_1123, &cols_mem_1132, "cols_mem_1132") !=
+        0)
+        return 1;
+    *out_out_arrsizze_1124 = sizze_1134;
+    *out_out_memsizze_1125 = bytes_1144;
+    (*out_mem_p_1126).references = NULL;
+    if (memblock_set(ctx, &*out_mem_p_1126, &rows_mem_1131, "rows_mem_1131") !=
+        0)
+        return 1;
+    *out_out_arrsizze_1127 = sizze_1134;
+    *out_out_memsizze_1128 = bytes_1144;
+    (*out_mem_p_1129).references = NULL;
+    if (memblock_set(ctx, &*out_mem_p_1129, &vals_mem_1133, "vals_mem_1133") !=
+        0)
+        return 1;
+    *out_out_arrsizze_1130 = sizze_1134;
+    return 0;
+}
+struct futhark_i32_1d {
+    struct memblock mem;
+    int64_t shape[1];
+} ;
+struct futhark_i32_1d *futhark_new_i32_1d(struct futhark_context *ctx,
+                                          int32_t *data, int dim0)
+{
+    struct futhark_i32_1d *arr = malloc(sizeof(struct futhark_i32_1d));
+    
+    if (arr == NULL)
+        return NULL;
+    lock_lock(&ctx->lock);
+    arr->mem.references = NULL;
+    if (memblock_alloc(ctx, &arr->mem, (int64_t) dim0 * sizeof(int32_t),
+                       "arr->mem")) {
+        lock_unlock(&ctx->lock);
+        free(arr);
+        return NULL;
+    }
+    arr->shape[0] = dim0;
+    memmove(arr->mem.mem + 0, data + 0, dim0 * sizeof(int32_t));
+    lock_unlock(&ctx->lock);
+    return arr;
+}
+struct futhark_i32_1d *futhark_new_raw_i32_1d(struct futhark_context *ctx,
+                                              char *data, int offset, int dim0)
+{
+    struct futhark_i32_1d *arr = malloc(sizeof(struct futhark_i32_1d));
+    
+    if (arr == NULL)
+        return NULL;
+    lock_lock(&ctx->lock);
+    arr->mem.references = NULL;
+    if (memblock_alloc(ctx, &arr->mem, (int64_t) dim0 * sizeof(int32_t),
+                       "arr->mem")) {
+        lock_unlock(&ctx->lock);
+        free(arr);
+        return NULL;
+    }
+    arr->shape[0] = dim0;
+    memmove(arr->mem.mem + 0, data + offset, dim0 * sizeof(int32_t));
+    lock_unlock(&ctx->lock);
+    return arr;
+}
+int futhark_free_i32_1d(struct futhark_context *ctx, struct futhark_i32_1d *arr)
+{
+    lock_lock(&ctx->lock);
+    if (memblock_unref(ctx, &arr->mem, "arr->mem") != 0) {
+        lock_unlock(&ctx->lock);
+        return 1;
+    }
+    lock_unlock(&ctx->lock);
+    free(arr);
+    return 0;
+}
+int futhark_values_i32_1d(struct futhark_context *ctx,
+                          struct futhark_i32_1d *arr, int32_t *data)
+{
+    lock_lock(&ctx->lock);
+    memmove(data + 0, arr->mem.mem + 0, arr->shape[0] * sizeof(int32_t));
+    lock_unlock(&ctx->lock);
+    return 0;
+}
+char *futhark_values_raw_i32_1d(struct futhark_context *ctx,
+                                struct futhark_i32_1d *arr)
+{
+    return arr->mem.mem;
+}
+int64_t *futhark_shape_i32_1d(struct futhark_context *ctx,
+                              struct futhark_i32_1d *arr)
+{
+    return arr->shape;
+}
+int futhark_entry_coo_get(struct futhark_context *ctx, int32_t *out0, const
+                          int32_t in0, const int32_t in1, const
+                          struct futhark_i32_1d *in2, const
+                          struct futhark_i32_1d *in3, const
+                          struct futhark_i32_1d *in4, const int32_t in5, const
+                          int32_t in6)
+{
+    struct memblock rows_mem_1101;
+    
+    rows_mem_1101.references = NULL;
+    
+    struct memblock cols_mem_1102;
+    
+    cols_mem_1102.references = NULL;
+    
+    struct memblock vals_mem_1103;
+    
+    vals_mem_1103.references = NULL;
+    
+    int32_t sizze_1104;
+    int32_t n_1105;
+    int32_t m_1106;
+    int32_t i_1107;
+    int32_t j_1108;
+    int32_t scalar_out_1109;
+    int ret = 0;
+    
+    lock_lock(&ctx->lock);
+    n_1105 = in0;
+    m_1106 = in1;
+    rows_mem_1101 = in2->mem;
+    sizze_1104 = in2->shape[0];
+    cols_mem_1102 = in3->mem;
+    vals_mem_1103 = in4->mem;
+    i_1107 = in5;
+    j_1108 = in6;
+    if (!(sizze_1104 == in3->shape[0] && sizze_1104 == in4->shape[0])) {
+        ret = 1;
+        ctx->error =
+            msgprintf("Error: entry point arguments have invalid sizes.\n");
+    }
+    if (ret == 0) {
+        struct futhark_memory_stats mem_before = {0, 0, 0, 0};
+        
+        memory_record_begin(ctx, &mem_before);
+        
+        int trace_1150 = trace_begin(ctx, "entry", "coo_get");
+        
+        ret = futrts_coo_get(ctx, &scalar_out_1109, rows_mem_1101,
+                             cols_mem_1102, vals_mem_1103, sizze_1104, n_1105,
+                             m_1106, i_1107, j_1108);
+        trace_end(ctx, trace_1150);
+        memory_record_end(ctx, "coo_get", &mem_before);
+    }
+    if (ret == 0) {
+        *out0 = scalar_out_1109;
+    }
+    lock_unlock(&ctx->lock);
+    return ret;
+}
+int futhark_entry_coo_transpose(struct futhark_context *ctx, int32_t *out0,
+                                int32_t *out1, struct futhark_i32_1d **out2,
+                                struct futhark_i32_1d **out3,
+                                struct futhark_i32_1d **out4, const
+                                int32_t in0, const int32_t in1, const
+                                struct futhark_i32_1d *in2, const
+                                struct futhark_i32_1d *in3, const
+                                struct futhark_i32_1d *in4)
+{
+    struct memblock rows_mem_1131;
+    
+    rows_mem_1131.references = NULL;
+    
+    struct memblock cols_mem_1132;
+    
+    cols_mem_1132.references = NULL;
+    
+    struct memblock vals_mem_1133;
+    
+    vals_mem_1133.references = NULL;
+    
+    int32_t sizze_1134;
+    int32_t n_1135;
+    int32_t m_1136;
+    int32_t scalar_out_1137;
+    int32_t scalar_out_1138;
+    int64_t out_memsizze_1151;
+    struct memblock out_mem_1152;
+    
+    out_mem_1152.references = NULL;
+    
+    int32_t out_arrsizze_1153;
+    int64_t out_memsizze_1154;
+    struct memblock out_mem_1155;
+    
+    out_mem_1155.references = NULL;
+    
+    int32_t out_arrsizze_1156;
+    int64_t out_memsizze_1157;
+    struct memblock out_mem_1158;
+    
+    out_mem_1158.references = NULL;
+    
+    int32_t out_arrsizze_1159;
+    int ret = 0;
+    
+    lock_lock(&ctx->lock);
+    n_1135 = in0;
+    m_1136 = in1;
+    rows_mem_1131 = in2->mem;
+    sizze_1134 = in2->shape[0];
+    cols_mem_1132 = in3->mem;
+    vals_mem_1133 = in4->mem;
+    if (!(sizze_1134 == in3->shape[0] && sizze_1134 == in4->shape[0])) {
+        ret = 1;
+        ctx->error =
+            msgprintf("Error: entry point arguments have invalid sizes.\n");
+    }
+    if (ret == 0) {
+        struct futhark_memory_stats mem_before = {0, 0, 0, 0};
+        
+        memory_record_begin(ctx, &mem_before);
+        
+        int trace_1160 = trace_begin(ctx, "entry", "coo_transpose");
+        
+        ret = futrts_coo_transpose(ctx, &scalar_out_1137, &scalar_out_1138,
+                                   &out_memsizze_1151, &out_mem_1152,
+                                   &out_arrsizze_1153, &out_memsizze_1154,
+                                   &out_mem_1155, &out_arrsizze_1156,
+                                   &out_memsizze_1157, &out_mem_1158,
+                                   &out_arrsizze_1159, rows_mem_1131,
+                                   cols_mem_1132, vals_mem_1133, sizze_1134,
+                                   n_1135, m_1136);
+        trace_end(ctx, trace_1160);
+        memory_record_end(ctx, "coo_transpose", &mem_before);
+    }
+    if (ret == 0) {
+        *out0 = scalar_out_1137;
+        *out1 = scalar_out_1138;
+        assert((*out2 = malloc(sizeof(struct futhark_i32_1d))) != NULL);
+        (*out2)->mem = out_mem_1152;
+        (*out2)->shape[0] = out_arrsizze_1153;
+        assert((*out3 = malloc(sizeof(struct futhark_i32_1d))) != NULL);
+        (*out3)->mem = out_mem_1155;
+        (*out3)->shape[0] = out_arrsizze_1156;
+        assert((*out4 = malloc(sizeof(struct futhark_i32_1d))) != NULL);
+        (*out4)->mem = out_mem_1158;
+        (*out4)->shape[0] = out_arrsizze_1159;
+    }
+    lock_unlock(&ctx->lock);
+    return ret;
+}
@@ -2,6 +2,10 @@
  * Headers
 */
 
+/* -std=c99 hides POSIX and Linux calls such as syscall */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -45,6 +49,37 @@ int futhark_entry_main(struct futhark_context *ctx, bool *out0);
 */
 
 void futhark_debugging_report(struct futhark_context *ctx);
+struct futhark_pool_stats {
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats);
+void futhark_context_pool_trim(struct futhark_context *ctx);
+struct futhark_memory_stats {
+    int64_t peak_bytes;
+    int64_t current_bytes;
+    int64_t allocations;
+    int64_t largest_allocation;
+} ;
+struct futhark_memory_record {
+    const char *entry_point;
+    int64_t bytes_before;
+    struct futhark_memory_stats stats;
+} ;
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats);
+void futhark_context_memory_reset(struct futhark_context *ctx);
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag);
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records);
+void futhark_context_clear_memory_records(struct futhark_context *ctx);
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag);
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path);
+void futhark_context_clear_trace(struct futhark_context *ctx);
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -112,6 +147,123 @@ static int64_t get_wall_time(void) {
 
 #endif
 
+/* Hardware performance counters around entry point calls, for
+   --perf-counters.  Each counter is opened on its own for this thread,
+   user space only, and read with its enabled and running times so that
+   a counter the kernel had to multiplex is scaled up.  A counter that
+   cannot be opened (no PMU, perf_event_paranoid, a container) is
+   reported as n/a and the others still work. */
+
+#define PERF_COUNTERS 4
+
+static const char *const perf_counter_names[PERF_COUNTERS] =
+  {"cycles", "instructions", "LLC-misses", "branch-misses"};
+
+struct perf_counters {
+  int fds[PERF_COUNTERS];
+  int64_t values[PERF_COUNTERS];
+};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void perf_counters_open(struct perf_counters *pc) {
+  static const uint64_t configs[PERF_COUNTERS] =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    pc->fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    uint64_t buf[3];
+    pc->values[i] = -1;
+    if (pc->fds[i] < 0) {
+      continue;
+    }
+    ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    if (read(pc->fds[i], buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0) {
+      pc->values[i] = buf[2] < buf[1] ? (int64_t)((double)buf[0] * buf[1] / buf[2]) : (int64_t)buf[0];
+    }
+  }
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->fds[i] >= 0) {
+      close(pc->fds[i]);
+    }
+    pc->fds[i] = -1;
+  }
+}
+
+#else
+
+static void perf_counters_open(struct perf_counters *pc) {
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    pc->fds[i] = -1;
+    pc->values[i] = -1;
+  }
+}
+
+static void perf_counters_start(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_stop(struct perf_counters *pc) {
+  (void)pc;
+}
+
+static void perf_counters_close(struct perf_counters *pc) {
+  (void)pc;
+}
+
+#endif
+
+/* One line per measurement: what was measured, the wall time, and the
+   counters, with instructions per cycle when both are known. */
+static void perf_counters_report(FILE *out, const char *what, int64_t wall_usec,
+                                 const struct perf_counters *pc) {
+  fprintf(out, "%s: %lld us", what, (long long)wall_usec);
+  for (int i = 0; i < PERF_COUNTERS; i++) {
+    if (pc->values[i] < 0) {
+      fprintf(out, ", %s n/a", perf_counter_names[i]);
+    } else {
+      fprintf(out, ", %s %lld", perf_counter_names[i], (long long)pc->values[i]);
+    }
+  }
+  if (pc->values[0] > 0 && pc->values[1] >= 0) {
+    fprintf(out, ", IPC %.2f", (double)pc->values[1] / pc->values[0]);
+  }
+  fputc('\n', out);
+}
+
 #include <string.h>
 #include <inttypes.h>
 #include <errno.h>
@@ -557,51 +709,84 @@ static int write_str_bool(FILE *out, void *src) {
 // Reading little-endian byte sequences.  On big-endian hosts, we flip
 // the resulting bytes.
 
+static uint16_t bswap_2byte(uint16_t x) {
+  return (x>>8) | (x<<8);
+}
+
+static uint32_t bswap_4byte(uint32_t x) {
+  return
+    ((x>>24)&0xFF) |
+    ((x>>8) &0xFF00) |
+    ((x<<8) &0xFF0000) |
+    ((x<<24)&0xFF000000);
+}
+
+static uint64_t bswap_8byte(uint64_t x) {
+  return
+    ((x>>56)&0xFFull) |
+    ((x>>40)&0xFF00ull) |
+    ((x>>24)&0xFF0000ull) |
+    ((x>>8) &0xFF000000ull) |
+    ((x<<8) &0xFF00000000ull) |
+    ((x<<24)&0xFF0000000000ull) |
+    ((x<<40)&0xFF000000000000ull) |
+    ((x<<56)&0xFF00000000000000ull);
+}
+
+// Convert n little-endian elements in place to host byte order.  A
+// no-op on little-endian hosts.
+static void le_to_host(void* data, size_t elem_size, size_t n) {
+  if (!IS_BIG_ENDIAN) {
+    return;
+  }
+  switch (elem_size) {
+  case 2:
+    for (size_t i = 0; i < n; i++) {
+      ((uint16_t*)data)[i] = bswap_2byte(((uint16_t*)data)[i]);
+    }
+    break;
+  case 4:
+    for (size_t i = 0; i < n; i++) {
+      ((uint32_t*)data)[i] = bswap_4byte(((uint32_t*)data)[i]);
+    }
+    break;
+  case 8:
+    for (size_t i = 0; i < n; i++) {
+      ((uint64_t*)data)[i] = bswap_8byte(((uint64_t*)data)[i]);
+    }
+    break;
+  }
+}
+
+// Bytes and time spent in bulk binary reads, for --load-rate.
+static int64_t bin_bytes_read = 0;
+static int64_t bin_read_usec = 0;
+
+// Read n little-endian elements with a single fread, rather than one
+// libc call per element.  Returns the number of elements read.
+static size_t read_le_bulk(void* dest, size_t elem_size, size_t n) {
+  int64_t t_start = get_wall_time();
+  size_t num_elems_read = fread(dest, elem_size, n, stdin);
+  le_to_host(dest, elem_size, num_elems_read);
+  bin_read_usec += get_wall_time() - t_start;
+  bin_bytes_read += num_elems_read * elem_size;
+  return num_elems_read;
+}
+
 static int read_byte(void* dest) {
-  int num_elems_read = fread(dest, 1, 1, stdin);
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 1, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_2byte(void* dest) {
-  uint16_t x;
-  int num_elems_read = fread(&x, 2, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x = (x>>8) | (x<<8);
-  }
-  *(uint16_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 2, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_4byte(void* dest) {
-  uint32_t x;
-  int num_elems_read = fread(&x, 4, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>24)&0xFF) |
-      ((x>>8) &0xFF00) |
-      ((x<<8) &0xFF0000) |
-      ((x<<24)&0xFF000000);
-  }
-  *(uint32_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 4, 1) == 1 ? 0 : 1;
 }
 
 static int read_le_8byte(void* dest) {
-  uint64_t x;
-  int num_elems_read = fread(&x, 8, 1, stdin);
-  if (IS_BIG_ENDIAN) {
-    x =
-      ((x>>56)&0xFFull) |
-      ((x>>40)&0xFF00ull) |
-      ((x>>24)&0xFF0000ull) |
-      ((x>>8) &0xFF000000ull) |
-      ((x<<8) &0xFF00000000ull) |
-      ((x<<24)&0xFF0000000000ull) |
-      ((x<<40)&0xFF000000000000ull) |
-      ((x<<56)&0xFF00000000000000ull);
-  }
-  *(uint64_t*)dest = x;
-  return num_elems_read == 1 ? 0 : 1;
+  return read_le_bulk(dest, 8, 1) == 1 ? 0 : 1;
 }
 
 static int write_byte(void* dest) {
@@ -794,12 +979,12 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
 
   uint64_t elem_count = 1;
+  size_t num_dims_read = read_le_bulk(shape, sizeof(int64_t), dims);
+  if (num_dims_read != (size_t)dims) {
+    panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", (int)num_dims_read);
+  }
   for (int i=0; i<dims; i++) {
-    uint64_t bin_shape;
-    ret = read_le_8byte(&bin_shape);
-    if (ret != 0) { panic(1, "binary-input: Couldn't read size for dimension %i of array.\n", i); }
-    elem_count *= bin_shape;
-    shape[i] = (int64_t) bin_shape;
+    elem_count *= (uint64_t) shape[i];
   }
 
   size_t elem_size = expected_type->size;
@@ -810,27 +995,12 @@ static int read_bin_array(const struct primtype_info_t *expected_type, void **da
   }
   *data = tmp;
 
-  size_t num_elems_read = fread(*data, elem_size, elem_count, stdin);
+  size_t num_elems_read = read_le_bulk(*data, elem_size, elem_count);
   if (num_elems_read != elem_count) {
     panic(1, "binary-input: tried to read %i elements of an array, but only got %i elements.\n",
           elem_count, num_elems_read);
   }
 
-  // If we're on big endian platform we must change all multibyte elements
-  // from using little endian to big endian
-  if (IS_BIG_ENDIAN && elem_size != 1) {
-    char* elems = (char*) *data;
-    for (uint64_t i=0; i<elem_count; i++) {
-      char* elem = elems+(i*elem_size);
-      for (unsigned int j=0; j<elem_size/2; j++) {
-        char head = elem[j];
-        int tail_index = elem_size-1-j;
-        elem[j] = elem[tail_index];
-        elem[tail_index] = head;
-      }
-    }
-  }
-
   return 0;
 }
 
@@ -938,7 +1108,573 @@ static int write_scalar(FILE *out, int write_binary, const struct primtype_info_
   }
 }
 
+/* Server mode.  Instead of running one entry point on stdin, the
+   program keeps named values alive between commands read from stdin
+   or, with --socket, from clients of a Unix socket:
+
+     call ENTRY OUT... IN...        run ENTRY on the named inputs
+     restore FILE VAR TYPE ...      read values from FILE, e.g. "[]i32"
+     store FILE VAR ...             write values to FILE
+     free VAR ...
+     rename OLD NEW
+     inputs ENTRY / outputs ENTRY   list parameter and result types
+     clear                          free everything
+     report                         futhark_debugging_report
+     exit                           stop the server
+
+   Arrays are kept as values of the program's array types, so call
+   hands them to the entry point as they are and its results stay in
+   the context; only restore and store copy data in or out.  FILE is in
+   the binary data format, as store writes it.  Every command is
+   answered with "%%% OK" on a line of its own, after a "%%% FAILURE"
+   line and a message if it failed.  A file that cannot be read fails
+   its restore, keeping the values read before the bad one. */
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// An array type of the entry points, under its name in "inputs"
+struct server_array_type {
+  const char *name;
+  const struct primtype_info_t *elem;
+  int rank;
+  void *(*new_array)(struct futhark_context *, const void *data, const int64_t *shape);
+  int (*free_array)(struct futhark_context *, void *arr);
+  int (*values)(struct futhark_context *, void *arr, void *data);
+  int64_t *(*shape)(struct futhark_context *, void *arr);
+};
+
+struct server_value {
+  char *name;
+  const char *type_name;
+  const struct primtype_info_t *type;     // of the scalar, or of the elements
+  const struct server_array_type *array;  // NULL for a scalar
+  void *data;                             // the scalar, or the array value
+};
+
+typedef int server_call_fun(struct futhark_context *, struct server_value **outs,
+                            struct server_value **ins);
+
+struct server_entry {
+  const char *name;
+  int num_ins;
+  const char *const *in_types;
+  int num_outs;
+  const char *const *out_types;
+  server_call_fun *call;
+};
+
+static int server_mode = 0;
+static const char *server_socket = NULL;
+
+static const struct server_array_type *server_array_types = NULL;
+static int server_num_array_types = 0;
+static struct server_value **server_values = NULL;
+static int server_num_values = 0;
+
+static void *server_malloc(size_t n) {
+  void *p = malloc(n == 0 ? 1 : n);
+  if (p == NULL) {
+    panic(1, "Out of memory in server mode.\n");
+  }
+  return p;
+}
+
+static char *server_strdup(const char *s) {
+  size_t n = strlen(s) + 1;
+  return memcpy(server_malloc(n), s, n);
+}
+
+static struct server_value *server_lookup(const char *name) {
+  for (int i = 0; i < server_num_values; i++) {
+    if (strcmp(server_values[i]->name, name) == 0) {
+      return server_values[i];
+    }
+  }
+  return NULL;
+}
+
+static void server_value_free(struct futhark_context *ctx, struct server_value *v) {
+  if (v->array == NULL) {
+    free(v->data);
+  } else if (v->data != NULL) {
+    v->array->free_array(ctx, v->data);
+  }
+  free(v->name);
+  free(v);
+}
+
+static void server_insert(struct server_value *v) {
+  struct server_value **grown =
+    realloc(server_values, (server_num_values + 1) * sizeof(struct server_value*));
+  if (grown == NULL) {
+    panic(1, "Out of memory in server mode.\n");
+  }
+  server_values = grown;
+  server_values[server_num_values++] = v;
+}
+
+static int server_remove(struct futhark_context *ctx, const char *name) {
+  for (int i = 0; i < server_num_values; i++) {
+    if (strcmp(server_values[i]->name, name) == 0) {
+      server_value_free(ctx, server_values[i]);
+      server_values[i] = server_values[--server_num_values];
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// A scalar of any primitive type, or one of the program's array types;
+// NULL if type_name is neither.  Arrays start out empty.
+static struct server_value *server_new_value(const char *name, const char *type_name) {
+  const struct server_array_type *array = NULL;
+  const struct primtype_info_t *type = NULL;
+  for (int i = 0; i < server_num_array_types; i++) {
+    if (strcmp(server_array_types[i].name, type_name) == 0) {
+      array = &server_array_types[i];
+      type = array->elem;
+    }
+  }
+  for (int i = 0; type == NULL && primtypes[i] != NULL; i++) {
+    if (strcmp(primtypes[i]->type_name, type_name) == 0) {
+      type = primtypes[i];
+    }
+  }
+  if (type == NULL) {
+    return NULL;
+  }
+  struct server_value *v = server_malloc(sizeof(struct server_value));
+  v->name = server_strdup(name);
+  v->type_name = array != NULL ? array->name : type->type_name;
+  v->type = type;
+  v->array = array;
+  v->data = array != NULL ? NULL : memset(server_malloc(type->size), 0, type->size);
+  return v;
+}
+
+// Read v from f, in the binary data format.  Returns an error message,
+// or NULL on success.
+static const char *server_read_value(struct futhark_context *ctx, FILE *f,
+                                     struct server_value *v) {
+  int rank = v->array == NULL ? 0 : v->array->rank;
+  int c;
+  while ((c = getc(f)) != EOF && isspace(c)) {
+  }
+  int8_t version, dims;
+  char binname[4];
+  if (c != 'b' || fread(&version, 1, 1, f) != 1 || fread(&dims, 1, 1, f) != 1
+      || fread(binname, 1, 4, f) != 4) {
+    return "not a value in the binary data format";
+  }
+  if (version != BINARY_FORMAT_VERSION) {
+    return "unsupported binary data format version";
+  }
+  if (dims != rank || memcmp(binname, v->type->binname, 4) != 0) {
+    return "value of the wrong type";
+  }
+  int64_t shape[8];
+  int64_t count = 1;
+  if (fread(shape, sizeof(int64_t), rank, f) != (size_t) rank) {
+    return "truncated value";
+  }
+  le_to_host(shape, sizeof(int64_t), rank);
+  for (int i = 0; i < rank; i++) {
+    // The array constructors take int dimensions
+    if (shape[i] < 0 || shape[i] > INT32_MAX) {
+      return "invalid array shape";
+    }
+    if (shape[i] > 0 && count > INT64_MAX / v->type->size / shape[i]) {
+      return "invalid array shape";
+    }
+    count *= shape[i];
+  }
+  // Check against what is left of the file before allocating for it
+  struct stat st;
+  long pos = ftell(f);
+  if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && pos >= 0
+      && count * v->type->size > st.st_size - pos) {
+    return "truncated value";
+  }
+  void *buf = rank == 0 ? v->data : malloc(count == 0 ? 1 : count * v->type->size);
+  if (buf == NULL) {
+    return "value too large";
+  }
+  if (fread(buf, v->type->size, count, f) != (size_t) count) {
+    if (rank > 0) {
+      free(buf);
+    }
+    return "truncated value";
+  }
+  le_to_host(buf, v->type->size, count);
+  if (rank > 0) {
+    v->data = v->array->new_array(ctx, buf, shape);
+    free(buf);
+    if (v->data == NULL) {
+      return "cannot make array";
+    }
+  }
+  return NULL;
+}
+
+static int server_write_value(struct futhark_context *ctx, FILE *f, struct server_value *v) {
+  if (v->array == NULL) {
+    int64_t no_shape[1] = {0};
+    return write_bin_array(f, v->type, v->data, no_shape, 0);
+  }
+  int64_t *shape = v->array->shape(ctx, v->data);
+  int64_t count = 1;
+  for (int i = 0; i < v->array->rank; i++) {
+    count *= shape[i];
+  }
+  void *buf = malloc(count == 0 ? 1 : count * v->type->size);
+  if (buf == NULL || v->array->values(ctx, v->data, buf) != 0) {
+    free(buf);
+    return 1;
+  }
+  int ret = write_bin_array(f, v->type, buf, shape, v->array->rank);
+  free(buf);
+  return ret;
+}
+
+static const struct server_entry *server_find_entry(const struct server_entry *entries,
+                                                    int num_entries, const char *name) {
+  for (int i = 0; i < num_entries; i++) {
+    if (strcmp(entries[i].name, name) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+// Returns an error message, or NULL on success.
+static const char *server_command(struct futhark_context *ctx, FILE *out,
+                                  const struct server_entry *entries, int num_entries,
+                                  char **words, int n, char *err, size_t errsize) {
+  const char *cmd = words[0];
+
+  if (strcmp(cmd, "call") == 0) {
+    const struct server_entry *e = n > 1 ? server_find_entry(entries, num_entries, words[1]) : NULL;
+    if (e == NULL) {
+      return "unknown entry point";
+    }
+    if (n != 2 + e->num_outs + e->num_ins) {
+      snprintf(err, errsize, "%s takes %d outputs and %d inputs", e->name, e->num_outs, e->num_ins);
+      return err;
+    }
+    struct server_value *ins[e->num_ins + 1], *outs[e->num_outs + 1];
+    for (int i = 0; i < e->num_ins; i++) {
+      ins[i] = server_lookup(words[2 + e->num_outs + i]);
+      if (ins[i] == NULL) {
+        snprintf(err, errsize, "unknown variable %s", words[2 + e->num_outs + i]);
+        return err;
+      }
+      if (strcmp(ins[i]->type_name, e->in_types[i]) != 0) {
+        snprintf(err, errsize, "%s does not have type %s", ins[i]->name, e->in_types[i]);
+        return err;
+      }
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      if (server_lookup(words[2 + i]) != NULL) {
+        snprintf(err, errsize, "variable %s already exists", words[2 + i]);
+        return err;
+      }
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      outs[i] = server_new_value(words[2 + i], e->out_types[i]);
+    }
+    int64_t t_start = get_wall_time();
+    int r = e->call(ctx, outs, ins);
+    if (r == 0) {
+      r = futhark_context_sync(ctx);
+    }
+    int64_t t_end = get_wall_time();
+    if (r != 0) {
+      for (int i = 0; i < e->num_outs; i++) {
+        server_value_free(ctx, outs[i]);
+      }
+      char *msg = futhark_context_get_error(ctx);
+      snprintf(err, errsize, "%s", msg != NULL ? msg : "entry point failed");
+      free(msg);
+      // Messages end in a newline of their own; the session adds one
+      for (size_t len = strlen(err); len > 0 && err[len - 1] == '\n'; len--) {
+        err[len - 1] = 0;
+      }
+      return err;
+    }
+    for (int i = 0; i < e->num_outs; i++) {
+      server_insert(outs[i]);
+    }
+    fprintf(out, "runtime: %lld\n", (long long) (t_end - t_start));
+    return NULL;
+  }
+
+  if (strcmp(cmd, "restore") == 0) {
+    if (n < 2 || (n - 2) % 2 != 0) {
+      return "usage: restore FILE VAR TYPE ...";
+    }
+    FILE *f = fopen(words[1], "rb");
+    if (f == NULL) {
+      snprintf(err, errsize, "%s: %s", words[1], strerror(errno));
+      return err;
+    }
+    const char *msg = NULL;
+    for (int i = 2; i < n && msg == NULL; i += 2) {
+      if (server_lookup(words[i]) != NULL) {
+        snprintf(err, errsize, "variable %s already exists", words[i]);
+        msg = err;
+        break;
+      }
+      struct server_value *v = server_new_value(words[i], words[i + 1]);
+      if (v == NULL) {
+        snprintf(err, errsize, "unsupported type %s", words[i + 1]);
+        msg = err;
+        break;
+      }
+      const char *problem = server_read_value(ctx, f, v);
+      if (problem != NULL) {
+        server_value_free(ctx, v);
+        snprintf(err, errsize, "cannot read %s from %s: %s", words[i], words[1], problem);
+        msg = err;
+        break;
+      }
+      server_insert(v);
+    }
+    fclose(f);
+    return msg;
+  }
+
+  if (strcmp(cmd, "store") == 0) {
+    if (n < 2) {
+      return "usage: store FILE VAR ...";
+    }
+    for (int i = 2; i < n; i++) {
+      if (server_lookup(words[i]) == NULL) {
+        snprintf(err, errsize, "unknown variable %s", words[i]);
+        return err;
+      }
+    }
+    FILE *f = fopen(words[1], "wb");
+    if (f == NULL) {
+      snprintf(err, errsize, "%s: %s", words[1], strerror(errno));
+      return err;
+    }
+    int failed = 0;
+    for (int i = 2; i < n; i++) {
+      failed |= server_write_value(ctx, f, server_lookup(words[i]));
+    }
+    failed |= ferror(f);
+    if (fclose(f) != 0 || failed) {
+      snprintf(err, errsize, "%s: write failed", words[1]);
+      return err;
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "free") == 0) {
+    for (int i = 1; i < n; i++) {
+      if (server_remove(ctx, words[i]) != 0) {
+        snprintf(err, errsize, "unknown variable %s", words[i]);
+        return err;
+      }
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "rename") == 0) {
+    if (n != 3) {
+      return "usage: rename OLD NEW";
+    }
+    struct server_value *v = server_lookup(words[1]);
+    if (v == NULL) {
+      snprintf(err, errsize, "unknown variable %s", words[1]);
+      return err;
+    }
+    if (server_lookup(words[2]) != NULL) {
+      snprintf(err, errsize, "variable %s already exists", words[2]);
+      return err;
+    }
+    free(v->name);
+    v->name = server_strdup(words[2]);
+    return NULL;
+  }
+
+  if (strcmp(cmd, "inputs") == 0 || strcmp(cmd, "outputs") == 0) {
+    const struct server_entry *e = n == 2 ? server_find_entry(entries, num_entries, words[1]) : NULL;
+    if (e == NULL) {
+      return "unknown entry point";
+    }
+    int inputs = strcmp(cmd, "inputs") == 0;
+    for (int i = 0; i < (inputs ? e->num_ins : e->num_outs); i++) {
+      fprintf(out, "%s\n", inputs ? e->in_types[i] : e->out_types[i]);
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "clear") == 0) {
+    while (server_num_values > 0) {
+      server_value_free(ctx, server_values[--server_num_values]);
+    }
+    return NULL;
+  }
+
+  if (strcmp(cmd, "report") == 0) {
+    futhark_debugging_report(ctx);
+    return NULL;
+  }
+
+  snprintf(err, errsize, "unknown command %s", cmd);
+  return err;
+}
+
+// Serve one command stream; returns 1 if it asked the server to exit.
+static int server_session(struct futhark_context *ctx, FILE *in, FILE *out,
+                          const struct server_entry *entries, int num_entries) {
+  char line[4096], err[1024];
+  char *words[256];
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    int n = 0;
+    for (char *w = strtok(line, " \t\r\n"); w != NULL && n < 256; w = strtok(NULL, " \t\r\n")) {
+      words[n++] = w;
+    }
+    if (n == 0) {
+      continue;
+    }
+    if (strcmp(words[0], "exit") == 0) {
+      fprintf(out, "%%%%%% OK\n");
+      fflush(out);
+      return 1;
+    }
+    const char *msg = server_command(ctx, out, entries, num_entries, words, n, err, sizeof(err));
+    if (msg != NULL) {
+      fprintf(out, "%%%%%% FAILURE\n%s\n", msg);
+    }
+    fprintf(out, "%%%%%% OK\n");
+    // A client that went away ends its own session, not the server
+    if (fflush(out) != 0 || ferror(out)) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+// Make room for a socket at path.  Only a socket nobody is listening on
+// any more, left by a server that did not get to remove it, is deleted.
+static void server_claim_socket(const struct sockaddr_un *addr) {
+  struct stat st;
+  if (lstat(addr->sun_path, &st) != 0) {
+    return;
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    panic(1, "%s exists and is not a socket\n", addr->sun_path);
+  }
+  int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  int live = probe >= 0 && connect(probe, (const struct sockaddr*) addr, sizeof(*addr)) == 0;
+  if (probe >= 0) {
+    close(probe);
+  }
+  if (live) {
+    panic(1, "Another server is listening on %s\n", addr->sun_path);
+  }
+  unlink(addr->sun_path);
+}
+
+static void server_run(struct futhark_context *ctx,
+                       const struct server_array_type *array_types, int num_array_types,
+                       const struct server_entry *entries, int num_entries) {
+  server_array_types = array_types;
+  server_num_array_types = num_array_types;
+  if (server_socket == NULL) {
+    server_session(ctx, stdin, stdout, entries, num_entries);
+  } else {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(server_socket) >= sizeof(addr.sun_path)) {
+      panic(1, "Socket path too long: %s\n", server_socket);
+    }
+    strcpy(addr.sun_path, server_socket);
+    server_claim_socket(&addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+      panic(1, "Cannot listen on %s: %s\n", server_socket, strerror(errno));
+    }
+    // Writes to a disconnected client fail with EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+    // One client at a time; the values outlive the connections
+    int done = 0;
+    while (!done) {
+      int conn = accept(fd, NULL, NULL);
+      if (conn < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        panic(1, "Cannot accept on %s: %s\n", server_socket, strerror(errno));
+      }
+      FILE *in = fdopen(conn, "r");
+      FILE *out = fdopen(dup(conn), "w");
+      if (in == NULL || out == NULL) {
+        panic(1, "Cannot open connection: %s\n", strerror(errno));
+      }
+      done = server_session(ctx, in, out, entries, num_entries);
+      fclose(in);
+      fclose(out);
+    }
+    close(fd);
+    unlink(server_socket);
+  }
+  while (server_num_values > 0) {
+    server_value_free(ctx, server_values[--server_num_values]);
+  }
+  free(server_values);
+}
 static int binary_output = 0;
+static int report_load_rate = 0;
+static int perf_counting = 0;
+static const char *trace_file = NULL;
+static struct perf_counters perf_counters;
+/* Separate from the per-run counters, which every run restarts. */
+static struct perf_counters perf_counters_total;
+static int report_memory = 0;
+/* One line per entry point, with the worst call for each counter. */
+static void print_memory_report(struct futhark_context *ctx)
+{
+    const struct futhark_memory_record *rs;
+    int n = futhark_context_memory_records(ctx, &rs);
+    
+    for (int i = 0; i < n; i++) {
+        int first = 1, calls = 0;
+        struct futhark_memory_stats worst = {0, 0, 0, 0};
+        
+        for (int j = 0; j < n; j++) {
+            if (strcmp(rs[i].entry_point, rs[j].entry_point) != 0)
+                continue;
+            if (j < i) {
+                first = 0;
+                break;
+            }
+            calls++;
+            if (rs[j].stats.peak_bytes - rs[j].bytes_before >
+                worst.peak_bytes)
+                worst.peak_bytes = rs[j].stats.peak_bytes -
+                    rs[j].bytes_before;
+            if (rs[j].stats.allocations > worst.allocations)
+                worst.allocations = rs[j].stats.allocations;
+            if (rs[j].stats.largest_allocation > worst.largest_allocation)
+                worst.largest_allocation = rs[j].stats.largest_allocation;
+        }
+        if (first)
+            fprintf(stderr,
+                    "Entry point %s: %d calls, at most %lld bytes above the live set, %lld allocations, largest %lld bytes.\n",
+                    rs[i].entry_point, calls, (long long) worst.peak_bytes,
+                    (long long) worst.allocations,
+                    (long long) worst.largest_allocation);
+    }
+}
 static FILE *runtime_file;
 static int perform_warmup = 0;
 static int num_runs = 1;
@@ -955,6 +1691,15 @@ int parse_options(struct futhark_context_config *cfg, int argc,
                                            {"entry-point", required_argument,
                                             NULL, 5}, {"binary-output",
                                                        no_argument, NULL, 6},
+                                           {"load-rate", no_argument, NULL, 7},
+                                           {"server", no_argument, NULL, 8},
+                                           {"socket", required_argument, NULL,
+                                            9}, {"memory-report", no_argument,
+                                                 NULL, 10}, {"perf-counters",
+                                                             no_argument, NULL,
+                                                             11}, {"trace",
+                                                                   required_argument,
+                                                                   NULL, 12},
                                            {0, 0, 0, 0}};
     
     while ((ch = getopt_long(argc, argv, ":t:r:DLe:b", long_options, NULL)) !=
@@ -978,6 +1723,20 @@ int parse_options(struct futhark_context_config *cfg, int argc,
             entry_point = optarg;
         if (ch == 6 || ch == 'b')
             binary_output = 1;
+        if (ch == 7)
+            report_load_rate = 1;
+        if (ch == 8)
+            server_mode = 1;
+        if (ch == 9) {
+            server_mode = 1;
+            server_socket = optarg;
+        }
+        if (ch == 10)
+            report_memory = 1;
+        if (ch == 11)
+            perf_counting = 1;
+        if (ch == 12)
+            trace_file = optarg;
         if (ch == ':')
             panic(-1, "Missing argument for option %s\n", argv[optind - 1]);
         if (ch == '?')
@@ -1016,6 +1775,8 @@ static void futrts_cli_entry_main(struct futhark_context *ctx)
         int r;
         
         assert(futhark_context_sync(ctx) == 0);
+        if (perf_counting)
+            perf_counters_start(&perf_counters);
         t_start = get_wall_time();
         r = futhark_entry_main(ctx, &result_78573);
         if (r != 0)
@@ -1025,6 +1786,14 @@ static void futrts_cli_entry_main(struct futhark_context *ctx)
         
         long elapsed_usec = t_end - t_start;
         
+        if (perf_counting) {
+            perf_counters_stop(&perf_counters);
+            
+            char what[64];
+            
+            snprintf(what, sizeof(what), "Entry point main, run %d", run);
+            perf_counters_report(stderr, what, elapsed_usec, &perf_counters);
+        }
         if (time_runs && runtime_file != NULL)
             fprintf(runtime_file, "%lld\n", (long long) elapsed_usec);
         if (run < num_runs - 1) {
@@ -1035,6 +1804,14 @@ static void futrts_cli_entry_main(struct futhark_context *ctx)
     printf("\n");
     ;
 }
+static const char *const futrts_server_outs_main[] = {"bool"};
+static int futrts_server_entry_main(struct futhark_context *ctx,
+                                    struct server_value **outs,
+                                    struct server_value **ins)
+{
+    (void) ins;
+    return futhark_entry_main(ctx, (bool *) outs[0]->data);
+}
 typedef void entry_point_fun(struct futhark_context *);
 struct entry_point_entry {
     const char *name;
@@ -1046,6 +1823,11 @@ int main(int argc, char **argv)
     
     struct entry_point_entry entry_points[] = {{.name ="main", .fun =
                                                 futrts_cli_entry_main}};
+    struct server_entry server_entries[] = {{.name ="main", .num_ins =0,
+                                             .in_types =NULL, .num_outs =1,
+                                             .out_types =
+                                             futrts_server_outs_main, .call =
+                                             futrts_server_entry_main}};
     struct futhark_context_config *cfg = futhark_context_config_new();
     
     assert(cfg != NULL);
@@ -1060,6 +1842,22 @@ int main(int argc, char **argv)
     struct futhark_context *ctx = futhark_context_new(cfg);
     
     assert(ctx != NULL);
+    if (report_memory)
+        futhark_context_set_memory_recording(ctx, 1);
+    if (trace_file != NULL)
+        futhark_context_set_tracing(ctx, 1);
+    if (perf_counting) {
+        perf_counters_open(&perf_counters);
+        perf_counters_open(&perf_counters_total);
+    }
+    
+    if (server_mode) {
+        server_run(ctx, NULL, 0, server_entries, sizeof(server_entries) /
+                   sizeof(server_entries[0]));
+        futhark_context_free(ctx);
+        futhark_context_config_free(cfg);
+        return 0;
+    }
     
     int num_entry_points = sizeof(entry_points) / sizeof(entry_points[0]);
     entry_point_fun *entry_point_fun = NULL;
@@ -1078,9 +1876,37 @@ int main(int argc, char **argv)
             fprintf(stderr, "%s\n", entry_points[i].name);
         return 1;
     }
+    
+    int64_t entry_start = get_wall_time();
+    
+    if (perf_counting)
+        perf_counters_start(&perf_counters_total);
     entry_point_fun(ctx);
+    if (perf_counting) {
+        perf_counters_stop(&perf_counters_total);
+        
+        char what[256];
+        
+        snprintf(what, sizeof(what), "Entry point %s, all runs and I/O",
+                 entry_point);
+        perf_counters_report(stderr, what, get_wall_time() - entry_start,
+                             &perf_counters_total);
+        perf_counters_close(&perf_counters_total);
+        perf_counters_close(&perf_counters);
+    }
     if (runtime_file != NULL)
         fclose(runtime_file);
+    if (trace_file != NULL && futhark_context_write_trace(ctx, trace_file) != 0)
+        panic(1, "Cannot write trace to %s: %s\n", trace_file,
+              strerror(errno));
+    if (report_load_rate)
+        fprintf(stderr,
+                "Read %lld bytes of binary input in %lld us (%.2f MB/s).\n",
+                (long long) bin_bytes_read, (long long) bin_read_usec,
+                bin_read_usec == 0 ? 0.0 : (double) bin_bytes_read /
+                bin_read_usec);
+    if (report_memory)
+        print_memory_report(ctx);
     futhark_debugging_report(ctx);
     futhark_context_free(ctx);
     futhark_context_config_free(cfg);
@@ -1170,6 +1996,22 @@ struct memblock {
     int64_t size;
     const char *desc;
 } ;
+/* Size-class pool behind memblock_alloc.  Class 0 holds blocks of up to
+   16 bytes, and after that every power of two is split into four
+   classes, so at most a fifth of a block is slack.  Freed blocks go on
+   the free list of their class instead of back to malloc, and are handed
+   out again by the next allocation of that class.  The reference count
+   and the free list link live in a header in front of the block, so in
+   the steady state of a loop nothing is allocated at all. */
+#define MEMBLOCK_POOL_CLASSES 256
+#define MEMBLOCK_HEADER 16
+struct memblock_pool {
+    char *free[MEMBLOCK_POOL_CLASSES];
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
 struct futhark_context_config {
     int debugging;
 } ;
@@ -1199,6 +2041,14 @@ void futhark_context_config_set_logging(struct futhark_context_config *cfg,
     cfg = cfg;
     detail = detail;
 }
+struct trace_event {
+    const char *cat;
+    const char *name;
+    int64_t start;
+    int64_t end;
+    int64_t allocated;
+    int64_t live;
+} ;
 struct futhark_context {
     int detail_memory;
     int debugging;
@@ -1206,6 +2056,16 @@ struct futhark_context {
     char *error;
     int64_t peak_mem_usage_default;
     int64_t cur_mem_usage_default;
+    struct memblock_pool pool;
+    int64_t num_allocs_default;
+    int64_t largest_alloc_default;
+    int record_memory;
+    struct futhark_memory_record *memory_records;
+    int num_memory_records;
+    int64_t alloc_bytes_default;
+    int tracing;
+    struct trace_event *trace_events;
+    int num_trace_events;
     struct memblock static_array_77802;
     struct memblock static_array_77813;
     struct memblock static_array_77814;
@@ -1231,6 +2091,16 @@ struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
     create_lock(&ctx->lock);
     ctx->peak_mem_usage_default = 0;
     ctx->cur_mem_usage_default = 0;
+    memset(&ctx->pool, 0, sizeof(ctx->pool));
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    ctx->record_memory = 0;
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    ctx->alloc_bytes_default = 0;
+    ctx->tracing = 0;
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
     ctx->static_array_77802 = (struct memblock) {NULL,
                                                  (char *) static_array_realtype_78561,
                                                  0};
@@ -1269,8 +2139,12 @@ struct futhark_context *futhark_context_new(struct futhark_context_config *cfg)
                                                  0};
     return ctx;
 }
+static void memblock_pool_trim(struct futhark_context *ctx);
 void futhark_context_free(struct futhark_context *ctx)
 {
+    memblock_pool_trim(ctx);
+    free(ctx->memory_records);
+    free(ctx->trace_events);
     free_lock(&ctx->lock);
     free(ctx);
 }
@@ -1286,6 +2160,89 @@ char *futhark_context_get_error(struct futhark_context *ctx)
     ctx->error = NULL;
     return error;
 }
+static int memblock_class(int64_t size)
+{
+    if (size <= 16)
+        return 0;
+    
+    int k = 4;
+    
+    while (((int64_t) 1 << (k + 1)) < size)
+        k++;
+    
+    int64_t step = (int64_t) 1 << (k - 2);
+    int64_t q = (size + step - 1) / step;
+    
+    return 4 * (k - 4) + (int) (q - 4);
+}
+static int64_t memblock_class_size(int c)
+{
+    if (c == 0)
+        return 16;
+    return (int64_t) (5 + (c - 1) % 4) << (4 + (c - 1) / 4 - 2);
+}
+static char **memblock_pool_link(char *raw)
+{
+    return (char **) (raw + sizeof(int64_t));
+}
+static char *memblock_pool_get(struct futhark_context *ctx, int64_t size)
+{
+    int c = memblock_class(size);
+    char *raw = ctx->pool.free[c];
+    
+    if (raw != NULL) {
+        ctx->pool.free[c] = *memblock_pool_link(raw);
+        ctx->pool.hits++;
+        ctx->pool.bytes_retained -= memblock_class_size(c);
+        ctx->pool.blocks_retained--;
+    } else {
+        raw = malloc(MEMBLOCK_HEADER + memblock_class_size(c));
+        if (raw == NULL)
+            panic(1, "Failed to allocate %lld bytes in %s.\n", (long long) size,
+                  "default space");
+        ctx->pool.misses++;
+    }
+    return raw;
+}
+static void memblock_pool_put(struct futhark_context *ctx, char *raw,
+                              int64_t size)
+{
+    int c = memblock_class(size);
+    
+    *memblock_pool_link(raw) = ctx->pool.free[c];
+    ctx->pool.free[c] = raw;
+    ctx->pool.bytes_retained += memblock_class_size(c);
+    ctx->pool.blocks_retained++;
+}
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    stats->hits = ctx->pool.hits;
+    stats->misses = ctx->pool.misses;
+    stats->bytes_retained = ctx->pool.bytes_retained;
+    stats->blocks_retained = ctx->pool.blocks_retained;
+    lock_unlock(&ctx->lock);
+}
+static void memblock_pool_trim(struct futhark_context *ctx)
+{
+    for (int c = 0; c < MEMBLOCK_POOL_CLASSES; c++) {
+        while (ctx->pool.free[c] != NULL) {
+            char *raw = ctx->pool.free[c];
+            
+            ctx->pool.free[c] = *memblock_pool_link(raw);
+            free(raw);
+        }
+    }
+    ctx->pool.bytes_retained = 0;
+    ctx->pool.blocks_retained = 0;
+}
+void futhark_context_pool_trim(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    memblock_pool_trim(ctx);
+    lock_unlock(&ctx->lock);
+}
 static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                           const char *desc)
 {
@@ -1297,8 +2254,7 @@ static int memblock_unref(struct futhark_context *ctx, struct memblock *block,
                     desc, block->desc, "default space", *block->references);
         if (*block->references == 0) {
             ctx->cur_mem_usage_default -= block->size;
-            free(block->mem);
-            free(block->references);
+            memblock_pool_put(ctx, (char *) block->references, block->size);
             if (ctx->detail_memory)
                 fprintf(stderr,
                         "%lld bytes freed (now allocated: %lld bytes)\n",
@@ -1319,12 +2275,18 @@ static int memblock_alloc(struct futhark_context *ctx, struct memblock *block,
     
     int ret = memblock_unref(ctx, block, desc);
     
-    block->mem = (char *) malloc(size);
-    block->references = (int *) malloc(sizeof(int));
+    char *raw = memblock_pool_get(ctx, size);
+    
+    block->references = (int *) raw;
+    block->mem = raw + MEMBLOCK_HEADER;
     *block->references = 1;
     block->size = size;
     block->desc = desc;
     ctx->cur_mem_usage_default += size;
+    ctx->num_allocs_default++;
+    ctx->alloc_bytes_default += size;
+    if (size > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = size;
     if (ctx->detail_memory)
         fprintf(stderr,
                 "Allocated %lld bytes for %s in %s (now allocated: %lld bytes)",
@@ -1347,11 +2309,208 @@ static int memblock_set(struct futhark_context *ctx, struct memblock *lhs,
     *lhs = *rhs;
     return ret;
 }
+/* Memory counters.  Peak, allocation count and largest allocation run
+   from context creation or the last futhark_context_memory_reset.  With
+   recording on, every entry point call also gets a record of its own:
+   the counters are zeroed when the call starts, copied into the record
+   when it returns, and then folded back into the running totals. */
+static void memory_stats_get(struct futhark_context *ctx,
+                             struct futhark_memory_stats *stats)
+{
+    stats->peak_bytes = ctx->peak_mem_usage_default;
+    stats->current_bytes = ctx->cur_mem_usage_default;
+    stats->allocations = ctx->num_allocs_default;
+    stats->largest_allocation = ctx->largest_alloc_default;
+}
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats)
+{
+    lock_lock(&ctx->lock);
+    memory_stats_get(ctx, stats);
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_memory_reset(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->record_memory = flag;
+    lock_unlock(&ctx->lock);
+}
+/* The records point into the context's own array, which the next
+   recorded entry point call may move, and which
+   futhark_context_clear_memory_records frees.  Copy them out before
+   calling into the context again. */
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records)
+{
+    lock_lock(&ctx->lock);
+    
+    int n = ctx->num_memory_records;
+    
+    *records = ctx->memory_records;
+    lock_unlock(&ctx->lock);
+    return n;
+}
+void futhark_context_clear_memory_records(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->memory_records);
+    ctx->memory_records = NULL;
+    ctx->num_memory_records = 0;
+    lock_unlock(&ctx->lock);
+}
+static void memory_record_begin(struct futhark_context *ctx,
+                                struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    memory_stats_get(ctx, saved);
+    ctx->peak_mem_usage_default = ctx->cur_mem_usage_default;
+    ctx->num_allocs_default = 0;
+    ctx->largest_alloc_default = 0;
+}
+static void memory_record_end(struct futhark_context *ctx, const char *entry,
+                              const struct futhark_memory_stats *saved)
+{
+    if (!ctx->record_memory)
+        return;
+    
+    int n = ctx->num_memory_records;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct futhark_memory_record *grown =
+                                     realloc(ctx->memory_records, (n == 0 ? 1 :
+                                                                   2 * n) *
+                                             sizeof(struct futhark_memory_record));
+        
+        if (grown == NULL)
+            panic(1, "Failed to record memory use of %s.\n", entry);
+        ctx->memory_records = grown;
+    }
+    
+    struct futhark_memory_record *r = &ctx->memory_records[n];
+    
+    r->entry_point = entry;
+    r->bytes_before = saved->current_bytes;
+    memory_stats_get(ctx, &r->stats);
+    ctx->num_memory_records = n + 1;
+    if (saved->peak_bytes > ctx->peak_mem_usage_default)
+        ctx->peak_mem_usage_default = saved->peak_bytes;
+    ctx->num_allocs_default += saved->allocations;
+    if (saved->largest_allocation > ctx->largest_alloc_default)
+        ctx->largest_alloc_default = saved->largest_allocation;
+}
+/* Tracing.  With tracing on, every entry point call is recorded with its
+   wall time, the bytes allocated while it ran and the bytes live when it
+   finished, and futhark_context_write_trace writes them as Chrome
+   trace-event JSON.  Only the entry point boundary is traced: phases
+   inside a body have no source names here and would be lost when the
+   program is regenerated, so make an operation its own entry point to
+   see it on the timeline. */
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag)
+{
+    lock_lock(&ctx->lock);
+    ctx->tracing = flag;
+    lock_unlock(&ctx->lock);
+}
+void futhark_context_clear_trace(struct futhark_context *ctx)
+{
+    lock_lock(&ctx->lock);
+    free(ctx->trace_events);
+    ctx->trace_events = NULL;
+    ctx->num_trace_events = 0;
+    lock_unlock(&ctx->lock);
+}
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path)
+{
+    FILE *out = fopen(path, "w");
+    
+    if (out == NULL)
+        return 1;
+    lock_lock(&ctx->lock);
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    
+    int first = 1;
+    
+    for (int i = 0; i < ctx->num_trace_events; i++) {
+        struct trace_event *e = &ctx->trace_events[i];
+        
+        if (e->end < 0)
+            continue;
+        fprintf(out,
+                "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %lld, \"dur\": %lld, \"args\": {\"allocated_bytes\": %lld, \"live_bytes\": %lld}},\n{\"name\": \"memory\", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, \"args\": {\"live_bytes\": %lld}}",
+                first ? "" : ",", e->name, e->cat, (long long) e->start,
+                (long long) (e->end - e->start), (long long) e->allocated,
+                (long long) e->live, (long long) e->end, (long long) e->live);
+        first = 0;
+    }
+    fprintf(out, "\n]}\n");
+    lock_unlock(&ctx->lock);
+    return fclose(out) != 0;
+}
+static int trace_begin(struct futhark_context *ctx, const char *cat,
+                       const char *name)
+{
+    if (!ctx->tracing)
+        return -1;
+    
+    int n = ctx->num_trace_events;
+    
+    // Grow by doubling; n is a power of two exactly when the array is full
+    if ((n & (n - 1)) == 0) {
+        struct trace_event *grown = realloc(ctx->trace_events, (n == 0 ? 1 :
+                                                                2 * n) *
+                                            sizeof(struct trace_event));
+        
+        if (grown == NULL)
+            panic(1, "Failed to trace %s.\n", name);
+        ctx->trace_events = grown;
+    }
+    
+    struct trace_event *e = &ctx->trace_events[n];
+    
+    e->cat = cat;
+    e->name = name;
+    e->end = -1;
+    e->allocated = ctx->alloc_bytes_default;
+    e->start = get_wall_time();
+    ctx->num_trace_events = n + 1;
+    return n;
+}
+static void trace_end(struct futhark_context *ctx, int event)
+{
+    if (event < 0)
+        return;
+    
+    struct trace_event *e = &ctx->trace_events[event];
+    
+    e->end = get_wall_time();
+    e->allocated = ctx->alloc_bytes_default - e->allocated;
+    e->live = ctx->cur_mem_usage_default;
+}
 void futhark_debugging_report(struct futhark_context *ctx)
 {
     if (ctx->detail_memory) {
         fprintf(stderr, "Peak memory usage for default space: %lld bytes.\n",
                 (long long) ctx->peak_mem_usage_default);
+        fprintf(stderr,
+                "%lld allocations, the largest %lld bytes.\n",
+                (long long) ctx->num_allocs_default,
+                (long long) ctx->largest_alloc_default);
+        fprintf(stderr,
+                "Memory pool: %lld hits, %lld misses, %lld bytes retained in %lld blocks.\n",
+                (long long) ctx->pool.hits, (long long) ctx->pool.misses,
+                (long long) ctx->pool.bytes_retained,
+                (long long) ctx->pool.blocks_retained);
     }
     if (ctx->debugging) { }
 }
@@ -38804,8 +39963,15 @@ int futhark_entry_main(struct futhark_context *ctx, bool *out0)
     
     lock_lock(&ctx->lock);
     
+    struct futhark_memory_stats mem_before = {0, 0, 0, 0};
+    
+    memory_record_begin(ctx, &mem_before);
+    
+    int trace_78600 = trace_begin(ctx, "entry", "main");
     int ret = futrts_main(ctx, &scalar_out_77801);
     
+    trace_end(ctx, trace_78600);
+    memory_record_end(ctx, "main", &mem_before);
     if (ret == 0) {
         *out0 = scalar_out_77801;
     }
@@ -0,0 +1,87 @@
+/*
+ * Public declarations of tupleTest.c, maintained by hand.  The layout
+ * follows what futhark c --library emits, but the pool, memory and
+ * trace functions below exist only in the hand-edited tupleTest.c in
+ * this directory.  Keep the two in step when either changes.
+*/
+
+/*
+ * Headers
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+/*
+ * Initialisation
+*/
+
+struct futhark_context_config ;
+struct futhark_context_config *futhark_context_config_new();
+void futhark_context_config_free(struct futhark_context_config *cfg);
+void futhark_context_config_set_debugging(struct futhark_context_config *cfg,
+                                          int flag);
+void futhark_context_config_set_logging(struct futhark_context_config *cfg,
+                                        int flag);
+struct futhark_context ;
+struct futhark_context *futhark_context_new(struct futhark_context_config *cfg);
+void futhark_context_free(struct futhark_context *ctx);
+int futhark_context_sync(struct futhark_context *ctx);
+char *futhark_context_get_error(struct futhark_context *ctx);
+
+/*
+ * Arrays
+*/
+
+
+/*
+ * Opaque values
+*/
+
+
+/*
+ * Entry points
+*/
+
+int futhark_entry_main(struct futhark_context *ctx, bool *out0);
+
+/*
+ * Miscellaneous
+*/
+
+void futhark_debugging_report(struct futhark_context *ctx);
+struct futhark_pool_stats {
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes_retained;
+    int64_t blocks_retained;
+} ;
+void futhark_context_pool_stats(struct futhark_context *ctx,
+                                struct futhark_pool_stats *stats);
+void futhark_context_pool_trim(struct futhark_context *ctx);
+struct futhark_memory_stats {
+    int64_t peak_bytes;
+    int64_t current_bytes;
+    int64_t allocations;
+    int64_t largest_allocation;
+} ;
+struct futhark_memory_record {
+    const char *entry_point;
+    int64_t bytes_before;
+    struct futhark_memory_stats stats;
+} ;
+void futhark_context_memory_stats(struct futhark_context *ctx,
+                                  struct futhark_memory_stats *stats);
+void futhark_context_memory_reset(struct futhark_context *ctx);
+void futhark_context_set_memory_recording(struct futhark_context *ctx,
+                                          int flag);
+/* Valid until the next entry point call or
+   futhark_context_clear_memory_records; copy the records out first. */
+int futhark_context_memory_records(struct futhark_context *ctx,
+                                   const struct futhark_memory_record **records);
+void futhark_context_clear_memory_records(struct futhark_context *ctx);
+void futhark_context_set_tracing(struct futhark_context *ctx, int flag);
+int futhark_context_write_trace(struct futhark_context *ctx, const char *path);
+void futhark_context_clear_trace(struct futhark_context *ctx);
@@ -0,0 +1,38 @@
+/*
+  The C++ interface of tupleTest.fut, over futhark.h++. tupleTest.h is
+  written by hand, not generated: it declares the public functions of the
+  tupleTest.c in this directory, including the pool, memory and trace
+  functions added to that file, which futhark c --library does not emit.
+  Link against this tupleTest.c, compiled with -Dmain=tupleTest_main so
+  that its command line main is out of the way, not against a freshly
+  generated one.
+
+    auto cfg = futhark::config::make();
+    auto ctx = futhark::context::make(std::move(cfg).value());
+    futhark::result<bool> ok = tupleTest::entryMain(ctx.value());
+    if (!ok) { ... ok.error().message ... }
+*/
+
+#ifndef TUPLETEST_HXX
+#define TUPLETEST_HXX
+
+extern "C" {
+#include "tupleTest.h"
+}
+
+#include "futhark.h++"
+
+namespace tupleTest {
+
+  // Whether all the tests of tupleTest.fut pass
+  inline futhark::result<bool> entryMain(futhark::context& ctx) {
+    bool out;
+    int code = futhark_entry_main(ctx.get(), &out);
+    if (code != 0) {
+      return ctx.takeError(code);
+    }
+    return out;
+  }
+}
+
+#endif